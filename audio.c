@@ -0,0 +1,223 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "audio.h"
+#include "rng.h"
+
+// Stand-ins for the missing wav files: a tone sliding from one frequency to
+// the other, mixed with some noise, fading out
+typedef struct Synth {
+    const char *name;
+    float from, to;
+    float duration;
+    float noise;
+    // Playback volume, 0-256
+    int volume;
+} Synth;
+
+static const Synth synths[AUDIO_SAMPLE_NUM] = {
+    { "drop", 880, 1320, 0.06f, 0, 96 },
+    { "hit", 220, 80, 0.25f, 0.6f, 256 },
+    { "force", 300, 600, 0.15f, 0, 160 },
+    { "berzerk", 110, 880, 0.5f, 0.2f, 256 },
+    { "bonus", 660, 1320, 0.2f, 0, 192 },
+    { "bomb", 90, 30, 0.7f, 0.8f, 256 },
+    { "level", 523, 1046, 0.4f, 0, 192 },
+};
+
+static Sint16 *take_pool(Audio *audio, Uint32 frames){
+    Sint16 *pcm = audio->pool + audio->pool_used;
+    if (frames > AUDIO_POOL_FRAMES - audio->pool_used)
+        return NULL;
+    audio->pool_used += frames;
+    return pcm;
+}
+
+static int synthesize(Audio *audio, const Synth *synth, AudioClip *clip){
+    Uint32 frames = synth->duration * audio->spec.freq, i, attack = audio->spec.freq / 500;
+    Sint16 *pcm = take_pool(audio, frames);
+    float phase = 0, t, envelope, v;
+    Rng rng;
+
+    if (pcm == NULL)
+        return -1;
+    rng_seed(&rng, 1, 2);
+    for (i = 0; i < frames; i++){
+        t = (float)i / frames;
+        phase += 2 * (float)M_PI * (synth->from + (synth->to - synth->from) * t) / audio->spec.freq;
+        // Ramp up over 2 ms, no click
+        envelope = (1 - t) * (1 - t) * (i < attack ? (float)i / attack : 1);
+        v = (1 - synth->noise) * sinf(phase) + synth->noise * (rng_below(&rng, 65536) / 32768.0f - 1);
+        pcm[i] = v * envelope * 16383;
+    }
+    clip->pcm = pcm;
+    clip->length = frames;
+    return 0;
+}
+
+// Converted to mono at the device rate, once
+static int load_wav(Audio *audio, const char *path, AudioClip *clip){
+    SDL_AudioSpec spec;
+    SDL_AudioCVT cvt;
+    Uint8 *data;
+    Uint32 length;
+    Sint16 *pcm;
+
+    if (SDL_LoadWAV(path, &spec, &data, &length) == NULL)
+        return -1;
+    if (SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq, AUDIO_S16SYS, 1, audio->spec.freq) < 0){
+        SDL_FreeWAV(data);
+        return -1;
+    }
+    cvt.len = length;
+    cvt.buf = malloc(length * cvt.len_mult);
+    if (cvt.buf == NULL){
+        SDL_FreeWAV(data);
+        return -1;
+    }
+    memcpy(cvt.buf, data, length);
+    SDL_FreeWAV(data);
+    if (SDL_ConvertAudio(&cvt) < 0 || (pcm = take_pool(audio, cvt.len_cvt / sizeof(Sint16))) == NULL){
+        free(cvt.buf);
+        return -1;
+    }
+    memcpy(pcm, cvt.buf, cvt.len_cvt);
+    clip->pcm = pcm;
+    clip->length = cvt.len_cvt / sizeof(Sint16);
+    free(cvt.buf);
+    return 0;
+}
+
+// New sounds take a free voice, or the one closest to its end
+static void take_commands(Audio *audio){
+    Uint32 head = __atomic_load_n(&audio->head, __ATOMIC_ACQUIRE), tail = audio->tail;
+    const AudioCommand *command;
+    const AudioClip *clip;
+    AudioVoice *voice;
+    int v, best;
+
+    for (; tail != head; tail++){
+        command = &audio->queue[tail & (AUDIO_QUEUE_SIZE - 1)];
+        clip = &audio->clips[command->sample];
+        if (clip->pcm == NULL)
+            continue;
+        for (v = 0, best = 0; v < AUDIO_VOICES; v++){
+            voice = &audio->voices[v];
+            if (voice->pcm == NULL){
+                best = v;
+                break;
+            }
+            if (voice->length - voice->position < audio->voices[best].length - audio->voices[best].position)
+                best = v;
+        }
+        voice = &audio->voices[best];
+        voice->pcm = clip->pcm;
+        voice->length = clip->length;
+        voice->position = 0;
+        voice->volume = command->volume;
+    }
+    __atomic_store_n(&audio->tail, tail, __ATOMIC_RELEASE);
+}
+
+static void mix(Audio *audio, int frames){
+    int channels = audio->spec.channels, v, i, c, n;
+    Sint32 *out, s;
+    AudioVoice *voice;
+
+    memset(audio->mix, 0, frames * channels * sizeof(Sint32));
+    for (v = 0; v < AUDIO_VOICES; v++){
+        voice = &audio->voices[v];
+        if (voice->pcm == NULL)
+            continue;
+        n = voice->length - voice->position < (Uint32)frames ? (int)(voice->length - voice->position) : frames;
+        out = audio->mix;
+        for (i = 0; i < n; i++){
+            s = voice->pcm[voice->position + i] * voice->volume >> 8;
+            for (c = 0; c < channels; c++)
+                *out++ += s;
+        }
+        voice->position += n;
+        if (voice->position >= voice->length)
+            voice->pcm = NULL;
+    }
+}
+
+// Runs on the audio thread: no allocation, no lock, no waiting
+static void callback(void *data, Uint8 *stream, int len){
+    Audio *audio = data;
+    Sint16 *out = (Sint16 *)stream;
+    int channels = audio->spec.channels, frames = len / (int)(sizeof(Sint16) * channels), chunk, i;
+    Sint32 s;
+
+    take_commands(audio);
+    while (frames > 0){
+        chunk = frames < audio->spec.samples ? frames : audio->spec.samples;
+        mix(audio, chunk);
+        for (i = 0; i < chunk * channels; i++){
+            s = audio->mix[i];
+            *out++ = s > 32767 ? 32767 : s < -32768 ? -32768 : s;
+        }
+        frames -= chunk;
+    }
+}
+
+int audio_open(Audio *audio, int buffer_frames){
+    char path[64];
+    int i;
+
+    memset(audio, 0, sizeof(*audio));
+    audio->spec.freq = 44100;
+    audio->spec.format = AUDIO_S16SYS;
+    audio->spec.channels = 2;
+    audio->spec.samples = buffer_frames;
+    audio->spec.callback = callback;
+    audio->spec.userdata = audio;
+    // SDL converts to what the device wants, we always get that format
+    if (SDL_OpenAudio(&audio->spec, NULL) < 0)
+        return -1;
+    audio->open = 1;
+    audio->pool = malloc(AUDIO_POOL_FRAMES * sizeof(Sint16));
+    audio->mix = malloc(audio->spec.samples * audio->spec.channels * sizeof(Sint32));
+    if (audio->pool == NULL || audio->mix == NULL){
+        audio_close(audio);
+        return -1;
+    }
+    for (i = 0; i < AUDIO_SAMPLE_NUM; i++){
+        snprintf(path, sizeof(path), "media/%s.wav", synths[i].name);
+        if (load_wav(audio, path, &audio->clips[i]) < 0 && synthesize(audio, &synths[i], &audio->clips[i]) < 0)
+            fprintf(stderr, "no room left for the %s sound\n", synths[i].name);
+    }
+    SDL_PauseAudio(0);
+    return 0;
+}
+
+void audio_close(Audio *audio){
+    if (audio->open)
+        SDL_CloseAudio();
+    free(audio->pool);
+    free(audio->mix);
+    memset(audio, 0, sizeof(*audio));
+}
+
+void audio_play(Audio *audio, int sample, int volume){
+    Uint32 head = audio->head;
+
+    if (!audio->open)
+        return;
+    if (head - __atomic_load_n(&audio->tail, __ATOMIC_ACQUIRE) == AUDIO_QUEUE_SIZE){
+        audio->dropped++;
+        return;
+    }
+    audio->queue[head & (AUDIO_QUEUE_SIZE - 1)].sample = sample;
+    audio->queue[head & (AUDIO_QUEUE_SIZE - 1)].volume = volume;
+    __atomic_store_n(&audio->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void audio_play_events(Audio *audio, Uint32 events){
+    int i;
+    for (i = 0; i < AUDIO_SAMPLE_NUM; i++){
+        if (events & (1 << i))
+            audio_play(audio, i, synths[i].volume);
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef DROPS_AUDIO_H
+#define DROPS_AUDIO_H
+
+#include <SDL.h>
+
+#include "game.h"
+
+#define AUDIO_VOICES 16
+// Sounds asked for and not mixed yet, a power of two
+#define AUDIO_QUEUE_SIZE 64
+// Mono frames of every sample together, decoded at startup
+#ifdef _PSP_FW_VERSION
+#define AUDIO_POOL_FRAMES (1 << 18)
+#else
+#define AUDIO_POOL_FRAMES (1 << 19)
+#endif
+// Frames per callback, the latency is about twice that
+#define AUDIO_DEFAULT_BUFFER 512
+
+// A sound per GAME_EVENT_* bit, in the same order
+enum AudioSample {
+    AUDIO_SAMPLE_DROP,
+    AUDIO_SAMPLE_HIT,
+    AUDIO_SAMPLE_FORCE_FIELD,
+    AUDIO_SAMPLE_BERZERK,
+    AUDIO_SAMPLE_BONUS,
+    AUDIO_SAMPLE_BOMB,
+    AUDIO_SAMPLE_LEVEL,
+    AUDIO_SAMPLE_NUM
+};
+
+// Mono, at the device rate, in the pool
+typedef struct AudioClip {
+    const Sint16 *pcm;
+    Uint32 length;
+} AudioClip;
+
+typedef struct AudioVoice {
+    const Sint16 *pcm;
+    Uint32 length, position;
+    // 0-256
+    int volume;
+} AudioVoice;
+
+typedef struct AudioCommand {
+    int sample;
+    int volume;
+} AudioCommand;
+
+typedef struct Audio {
+    int open;
+    SDL_AudioSpec spec;
+    Sint16 *pool;
+    Uint32 pool_used;
+    AudioClip clips[AUDIO_SAMPLE_NUM];
+    // Single producer, the game loop, and single consumer, the callback
+    AudioCommand queue[AUDIO_QUEUE_SIZE];
+    Uint32 head, tail;
+    // Sounds left out because the queue was full
+    Uint32 dropped;
+    // Callback only
+    AudioVoice voices[AUDIO_VOICES];
+    Sint32 *mix;
+} Audio;
+
+// After SDL_Init(SDL_INIT_AUDIO). Samples come from media/<name>.wav when
+// there is one, they are synthesized otherwise.
+int audio_open(Audio *audio, int buffer_frames);
+void audio_close(Audio *audio);
+// Never blocks nor allocates, the callback picks it up on its next run
+void audio_play(Audio *audio, int sample, int volume);
+// The sounds of the GAME_EVENT_* bits of an update
+void audio_play_events(Audio *audio, Uint32 events);
+
+#endif
@@ -0,0 +1,181 @@
+#include <string.h>
+
+#include "batch.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define BATCH_SSE2
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BATCH_AVX2
+#endif
+#endif
+
+typedef void (*ChaseKernel)(int *x, int *y, const int *speed, int count, int px, int py);
+typedef void (*CollideKernel)(int cx, int cy, int r, const int *x, const int *y, int size, int count, unsigned char *hit);
+
+static void chase_scalar(int *x, int *y, const int *speed, int count, int px, int py){
+    int i;
+    for (i = 0; i < count; i++){
+        if (x[i] > px)
+            x[i] -= speed[i];
+        if (y[i] > py)
+            y[i] -= speed[i];
+        if (x[i] < px)
+            x[i] += speed[i];
+        if (y[i] < py)
+            y[i] += speed[i];
+    }
+}
+
+// Same test as collide(), distances are clamped to 16 bits like the SIMD ones
+static void collide_scalar(int cx, int cy, int r, const int *x, const int *y, int size, int count, unsigned char *hit){
+    int i, dx, dy, reach = (r + size) * (r + size);
+    for (i = 0; i < count; i++){
+        dx = x[i] - cx;
+        dy = y[i] - cy;
+        dx = dx < -32768 ? -32768 : dx > 32767 ? 32767 : dx;
+        dy = dy < -32768 ? -32768 : dy > 32767 ? 32767 : dy;
+        hit[i] = dx * dx + dy * dy < reach;
+    }
+}
+
+// Only written before any thread runs the game
+static ChaseKernel chase_kernel = chase_scalar;
+static CollideKernel collide_kernel = collide_scalar;
+static const char *kernels_name = "scalar";
+
+#if defined(BATCH_SSE2)
+// One step toward p: v > p moves down by s, then v < p moves up by s
+static __m128i step4(__m128i v, __m128i p, __m128i s){
+    v = _mm_sub_epi32(v, _mm_and_si128(_mm_cmpgt_epi32(v, p), s));
+    return _mm_add_epi32(v, _mm_and_si128(_mm_cmplt_epi32(v, p), s));
+}
+
+static void chase_sse2(int *x, int *y, const int *speed, int count, int px, int py){
+    __m128i vpx = _mm_set1_epi32(px), vpy = _mm_set1_epi32(py), s;
+    int i;
+    for (i = 0; i + 4 <= count; i += 4){
+        s = _mm_loadu_si128((const __m128i *)(speed + i));
+        _mm_storeu_si128((__m128i *)(x + i), step4(_mm_loadu_si128((const __m128i *)(x + i)), vpx, s));
+        _mm_storeu_si128((__m128i *)(y + i), step4(_mm_loadu_si128((const __m128i *)(y + i)), vpy, s));
+    }
+    chase_scalar(x + i, y + i, speed + i, count - i, px, py);
+}
+
+// dx * dx + dy * dy from the saturated 16 bit pairs, in a single madd
+static __m128i distance4(__m128i dx, __m128i dy){
+    __m128i d = _mm_packs_epi32(dx, dy);
+    d = _mm_unpacklo_epi16(d, _mm_srli_si128(d, 8));
+    return _mm_madd_epi16(d, d);
+}
+
+static void collide_sse2(int cx, int cy, int r, const int *x, const int *y, int size, int count, unsigned char *hit){
+    __m128i vcx = _mm_set1_epi32(cx), vcy = _mm_set1_epi32(cy);
+    __m128i reach = _mm_set1_epi32((r + size) * (r + size)), dx, dy;
+    int i, mask;
+    for (i = 0; i + 4 <= count; i += 4){
+        dx = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(x + i)), vcx);
+        dy = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(y + i)), vcy);
+        mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(distance4(dx, dy), reach)));
+        hit[i] = mask & 1;
+        hit[i + 1] = (mask >> 1) & 1;
+        hit[i + 2] = (mask >> 2) & 1;
+        hit[i + 3] = mask >> 3;
+    }
+    collide_scalar(cx, cy, r, x + i, y + i, size, count - i, hit + i);
+}
+#endif
+
+#if defined(BATCH_AVX2)
+__attribute__((target("avx2")))
+static __m256i step8(__m256i v, __m256i p, __m256i s){
+    v = _mm256_sub_epi32(v, _mm256_and_si256(_mm256_cmpgt_epi32(v, p), s));
+    return _mm256_add_epi32(v, _mm256_and_si256(_mm256_cmpgt_epi32(p, v), s));
+}
+
+__attribute__((target("avx2")))
+static void chase_avx2(int *x, int *y, const int *speed, int count, int px, int py){
+    __m256i vpx = _mm256_set1_epi32(px), vpy = _mm256_set1_epi32(py), s;
+    int i;
+    for (i = 0; i + 8 <= count; i += 8){
+        s = _mm256_loadu_si256((const __m256i *)(speed + i));
+        _mm256_storeu_si256((__m256i *)(x + i), step8(_mm256_loadu_si256((const __m256i *)(x + i)), vpx, s));
+        _mm256_storeu_si256((__m256i *)(y + i), step8(_mm256_loadu_si256((const __m256i *)(y + i)), vpy, s));
+    }
+    chase_scalar(x + i, y + i, speed + i, count - i, px, py);
+}
+
+// Packing works within 128 bit lanes, which keeps the pairs in order
+__attribute__((target("avx2")))
+static void collide_avx2(int cx, int cy, int r, const int *x, const int *y, int size, int count, unsigned char *hit){
+    __m256i vcx = _mm256_set1_epi32(cx), vcy = _mm256_set1_epi32(cy);
+    __m256i reach = _mm256_set1_epi32((r + size) * (r + size)), dx, dy, d;
+    int i, k, mask;
+    for (i = 0; i + 8 <= count; i += 8){
+        dx = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(x + i)), vcx);
+        dy = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(y + i)), vcy);
+        d = _mm256_packs_epi32(dx, dy);
+        d = _mm256_unpacklo_epi16(d, _mm256_srli_si256(d, 8));
+        d = _mm256_madd_epi16(d, d);
+        mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(reach, d)));
+        for (k = 0; k < 8; k++)
+            hit[i + k] = (mask >> k) & 1;
+    }
+    collide_scalar(cx, cy, r, x + i, y + i, size, count - i, hit + i);
+}
+#endif
+
+void batch_init(){
+    chase_kernel = chase_scalar;
+    collide_kernel = collide_scalar;
+    kernels_name = "scalar";
+#if defined(BATCH_SSE2)
+    chase_kernel = chase_sse2;
+    collide_kernel = collide_sse2;
+    kernels_name = "sse2";
+#endif
+#if defined(BATCH_AVX2)
+    if (__builtin_cpu_supports("avx2")){
+        chase_kernel = chase_avx2;
+        collide_kernel = collide_avx2;
+        kernels_name = "avx2";
+    }
+#endif
+}
+
+void chase_batch(int *x, int *y, const int *speed, int count, int px, int py){
+    chase_kernel(x, y, speed, count, px, py);
+}
+
+void collide_batch(int cx, int cy, int r, const int *x, const int *y, int size, int count, unsigned char *hit){
+    collide_kernel(cx, cy, r, x, y, size, count, hit);
+}
+
+int batch_select(const char *name){
+    if (!strcmp(name, "scalar")){
+        chase_kernel = chase_scalar;
+        collide_kernel = collide_scalar;
+    }
+#if defined(BATCH_SSE2)
+    else if (!strcmp(name, "sse2")){
+        chase_kernel = chase_sse2;
+        collide_kernel = collide_sse2;
+    }
+#endif
+#if defined(BATCH_AVX2)
+    else if (!strcmp(name, "avx2") && __builtin_cpu_supports("avx2")){
+        chase_kernel = chase_avx2;
+        collide_kernel = collide_avx2;
+    }
+#endif
+    else {
+        return -1;
+    }
+    kernels_name = name;
+    return 0;
+}
+
+const char *batch_kernels(){
+    return kernels_name;
+}
@@ -0,0 +1,18 @@
+#ifndef DROPS_BATCH_H
+#define DROPS_BATCH_H
+
+// Kernels run on whole entity columns at once, scalar until batch_init()
+// picks the best ones for the CPU.
+
+// Move each entity by speed[i] toward (px, py), x first then y, like the chase
+// loop always did. Negative speeds move away, and 0 leaves it in place.
+void chase_batch(int *x, int *y, const int *speed, int count, int px, int py);
+// hit[i] = 1 when the circle (x[i], y[i], size) overlaps (cx, cy, r)
+void collide_batch(int cx, int cy, int r, const int *x, const int *y, int size, int count, unsigned char *hit);
+// Call before starting any thread that runs the game
+void batch_init();
+const char *batch_kernels();
+// Force a kernel set, also before any thread, by name ("scalar", "sse2", "avx2"), -1 if unavailable
+int batch_select(const char *name);
+
+#endif
@@ -0,0 +1,62 @@
+#include <string.h>
+
+#include "delta.h"
+
+static uint8_t *put_varint(uint8_t *out, uint32_t v){
+    while (v >= 0x80){
+        *out++ = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    *out++ = v;
+    return out;
+}
+
+static const uint8_t *get_varint(const uint8_t *in, uint32_t *v){
+    int shift = 0;
+    *v = 0;
+    do {
+        *v |= (uint32_t)(*in & 0x7f) << shift;
+        shift += 7;
+    } while (*in++ & 0x80);
+    return in;
+}
+
+uint32_t delta_encode(uint8_t *out, const uint32_t *in, size_t words){
+    uint8_t *start = out;
+    size_t i = 0, run, zeros;
+
+    while (i < words){
+        // Mostly unchanged, skip them four at a time
+        for (run = i; i + 4 <= words && !(in[i] | in[i + 1] | in[i + 2] | in[i + 3]); i += 4)
+            ;
+        for (; i < words && !in[i]; i++)
+            ;
+        if (i == words)
+            break;
+        zeros = i - run;
+        // Lone zero words cost less as literals than as a run of their own
+        for (run = i; i < words && (in[i] || (i + 1 < words && in[i + 1])); i++)
+            ;
+        out = put_varint(out, zeros);
+        out = put_varint(out, i - run);
+        memcpy(out, in + run, (i - run) * 4);
+        out += (i - run) * 4;
+    }
+    return out - start;
+}
+
+void delta_apply(uint32_t *image, const uint8_t *in, uint32_t size){
+    const uint8_t *end = in + size;
+    uint32_t zeros, literals, word;
+
+    while (in < end){
+        in = get_varint(in, &zeros);
+        in = get_varint(in, &literals);
+        image += zeros;
+        for (; literals; literals--){
+            memcpy(&word, in, 4);
+            *image++ ^= word;
+            in += 4;
+        }
+    }
+}
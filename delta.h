@@ -0,0 +1,20 @@
+#ifndef DROPS_DELTA_H
+#define DROPS_DELTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Run-length encoding of mostly zero 32 bit words, such as the XOR of two
+// snapshots: a varint count of zero words, a varint count of literal words,
+// the literal words, over and over. Trailing zeros are left out.
+
+// Encoded size of 'words' words at worst. Zero runs of one word go in with
+// the literals, so there are at most a third as many runs as words.
+#define DELTA_BOUND(words) ((words) * 6 + 16)
+
+// Returns the encoded size
+uint32_t delta_encode(uint8_t *out, const uint32_t *in, size_t words);
+// XOR the encoded words into 'image'
+void delta_apply(uint32_t *image, const uint8_t *in, uint32_t size);
+
+#endif
@@ -0,0 +1,46 @@
+#include <string.h>
+
+#include "dirty.h"
+#include "game.h"
+
+void dirty_begin(DirtyRects *dirty){
+    memcpy(dirty->previous, dirty->current, dirty->current_count * sizeof(SDL_Rect));
+    dirty->previous_count = dirty->current_count;
+    dirty->current_count = 0;
+    dirty->valid = 1;
+}
+
+void dirty_add(DirtyRects *dirty, int x, int y, int w, int h){
+    SDL_Rect *rect;
+
+    if (x < 0){
+        w += x;
+        x = 0;
+    }
+    if (y < 0){
+        h += y;
+        y = 0;
+    }
+    if (x + w > WIDTH)
+        w = WIDTH - x;
+    if (y + h > HEIGHT)
+        h = HEIGHT - y;
+    if (w <= 0 || h <= 0)
+        return;
+
+    if (dirty->current_count == DIRTY_MAX){
+        dirty->valid = 0;
+        return;
+    }
+    rect = &dirty->current[dirty->current_count++];
+    rect->x = x;
+    rect->y = y;
+    rect->w = w;
+    rect->h = h;
+}
+
+int dirty_collect(const DirtyRects *dirty, SDL_Rect *out){
+    memcpy(out, dirty->previous, dirty->previous_count * sizeof(SDL_Rect));
+    memcpy(out + dirty->previous_count, dirty->current, dirty->current_count * sizeof(SDL_Rect));
+    return dirty->previous_count + dirty->current_count;
+}
@@ -0,0 +1,26 @@
+#ifndef DROPS_DIRTY_H
+#define DROPS_DIRTY_H
+
+#include <SDL.h>
+
+// Past this, updating the whole screen is cheaper anyway
+#define DIRTY_MAX 256
+
+// Screen areas touched while drawing the last two frames
+typedef struct DirtyRects {
+    SDL_Rect previous[DIRTY_MAX];
+    SDL_Rect current[DIRTY_MAX];
+    int previous_count, current_count;
+    // Every area drawn during the current frame got recorded
+    int valid;
+    // The current frame only redraws and presents the recorded areas
+    int partial;
+} DirtyRects;
+
+// Start recording a new frame, what was recorded so far becomes 'previous'
+void dirty_begin(DirtyRects *dirty);
+void dirty_add(DirtyRects *dirty, int x, int y, int w, int h);
+// Areas to present for a partial frame, 'out' must hold 2 * DIRTY_MAX rects
+int dirty_collect(const DirtyRects *dirty, SDL_Rect *out);
+
+#endif
@@ -0,0 +1,339 @@
+// SDL2 front end: the same game, drawn through SDL_Renderer so it runs on
+// the GPU when there is one. Circles and glyphs are collected into vertex
+// batches, each run of them sharing a texture is a single
+// SDL_RenderGeometry() call.
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+#include <SDL_image.h>
+#include <SDL_ttf.h>
+
+#include "frontend.h"
+
+#define CIRCLE_MAX_SEGMENTS 256
+
+// Triangles waiting to be drawn in one call
+typedef struct Geometry {
+    SDL_Vertex *vertices;
+    int *indices;
+    int vertex_count, index_count;
+    int vertex_capacity, index_capacity;
+} Geometry;
+
+typedef struct Hardware {
+    SDL_Window *window;
+    SDL_Renderer *renderer;
+    // Skip the GPU even when there is one
+    int software;
+    TTF_Font *big_font;
+    TTF_Font *medium_font;
+    SDL_Texture *big_glyphs;
+    SDL_Texture *medium_glyphs;
+    SDL_Texture *faces[FACE_NUM];
+    SDL_Texture *background;
+    // Triangles sharing 'batch_texture' not drawn yet. They are drawn before
+    // anything else is, the picture comes out in the order it was asked for.
+    Geometry batch;
+    SDL_Texture *batch_texture;
+} Hardware;
+
+Hardware hardware;
+
+// cos and sin around the circle, for each segment count asked so far
+static float *unit_circles[CIRCLE_MAX_SEGMENTS + 1];
+
+const char option_usage[] = "       [--software]\n";
+
+int parse_option(int argc, char *argv[], int i){
+    if (!strcmp(argv[i], "--software"))
+        hardware.software = 1;
+    else
+        return -1;
+    return i;
+}
+
+int reserve(Geometry *geometry, int vertices, int indices){
+    void *grown;
+    int capacity;
+
+    if (geometry->vertex_count + vertices > geometry->vertex_capacity){
+        capacity = 2 * (geometry->vertex_count + vertices);
+        grown = realloc(geometry->vertices, capacity * sizeof(SDL_Vertex));
+        if (grown == NULL)
+            return -1;
+        geometry->vertices = grown;
+        geometry->vertex_capacity = capacity;
+    }
+    if (geometry->index_count + indices > geometry->index_capacity){
+        capacity = 2 * (geometry->index_count + indices);
+        grown = realloc(geometry->indices, capacity * sizeof(int));
+        if (grown == NULL)
+            return -1;
+        geometry->indices = grown;
+        geometry->index_capacity = capacity;
+    }
+    return 0;
+}
+
+void flush(){
+    Geometry *geometry = &hardware.batch;
+    if (geometry->index_count)
+        SDL_RenderGeometry(hardware.renderer, hardware.batch_texture, geometry->vertices, geometry->vertex_count,
+                           geometry->indices, geometry->index_count);
+    geometry->vertex_count = geometry->index_count = 0;
+}
+
+// The batch to add triangles drawn with 'texture' to, NULL for plain colors
+Geometry *batch(SDL_Texture *texture){
+    if (texture != hardware.batch_texture){
+        flush();
+        hardware.batch_texture = texture;
+    }
+    return &hardware.batch;
+}
+
+SDL_Color sdl_color(Uint32 rgba){
+    SDL_Color c;
+    c.r = rgba >> 24;
+    c.g = (rgba >> 16) & 0xff;
+    c.b = (rgba >> 8) & 0xff;
+    c.a = rgba & 0xff;
+    return c;
+}
+
+// Few segments for the tiny circles, within a quarter pixel for the big ones
+const float *unit_circle(int r, int *segments){
+    int n = 8 + (int)(M_PI * sqrtf(2.0f * r)), i;
+
+    if (n > CIRCLE_MAX_SEGMENTS)
+        n = CIRCLE_MAX_SEGMENTS;
+    *segments = n;
+    if (unit_circles[n] == NULL){
+        unit_circles[n] = malloc(2 * n * sizeof(float));
+        if (unit_circles[n] == NULL)
+            return NULL;
+        for (i = 0; i < n; i++){
+            unit_circles[n][2 * i] = cosf(2 * M_PI * i / n);
+            unit_circles[n][2 * i + 1] = sinf(2 * M_PI * i / n);
+        }
+    }
+    return unit_circles[n];
+}
+
+// A fan out to r - 0.5, then a ring fading out to r + 0.5: the same coverage
+// as the circle sprites of the SDL 1.2 build
+void fill_circle(int x, int y, int r, Uint32 rgba){
+    Geometry *geometry = batch(NULL);
+    SDL_Color solid = sdl_color(rgba), clear = solid;
+    const float *unit;
+    SDL_Vertex *v;
+    int *index, n, i, next, base;
+
+    if (r < 1)
+        return;
+    unit = unit_circle(r, &n);
+    if (unit == NULL || reserve(geometry, 2 * n + 1, 9 * n) < 0)
+        return;
+    clear.a = 0;
+    base = geometry->vertex_count;
+    v = geometry->vertices + base;
+    memset(v, 0, (2 * n + 1) * sizeof(SDL_Vertex));
+    v[0].position.x = x + 0.5f;
+    v[0].position.y = y + 0.5f;
+    v[0].color = solid;
+    for (i = 0; i < n; i++){
+        v[1 + 2 * i].position.x = x + 0.5f + (r - 0.5f) * unit[2 * i];
+        v[1 + 2 * i].position.y = y + 0.5f + (r - 0.5f) * unit[2 * i + 1];
+        v[1 + 2 * i].color = solid;
+        v[2 + 2 * i].position.x = x + 0.5f + (r + 0.5f) * unit[2 * i];
+        v[2 + 2 * i].position.y = y + 0.5f + (r + 0.5f) * unit[2 * i + 1];
+        v[2 + 2 * i].color = clear;
+    }
+    geometry->vertex_count += 2 * n + 1;
+
+    index = geometry->indices + geometry->index_count;
+    for (i = 0; i < n; i++){
+        next = (i + 1) % n;
+        *index++ = base;
+        *index++ = base + 1 + 2 * i;
+        *index++ = base + 1 + 2 * next;
+        *index++ = base + 1 + 2 * i;
+        *index++ = base + 2 + 2 * i;
+        *index++ = base + 1 + 2 * next;
+        *index++ = base + 2 + 2 * i;
+        *index++ = base + 2 + 2 * next;
+        *index++ = base + 1 + 2 * next;
+    }
+    geometry->index_count += 9 * n;
+}
+
+// One textured quad per glyph, out of the font atlas
+void print(int x, int y, GlyphAtlas *font, const char *text, Uint32 rgba){
+    Geometry *geometry = batch(font == &frontend.big_atlas ? hardware.big_glyphs : hardware.medium_glyphs);
+    SDL_Color c = sdl_color(rgba);
+    const SDL_Rect *glyph;
+    float u, v, du, dv, left;
+    SDL_Vertex *q;
+    int *index, g, k, base;
+
+    if (font->surface == NULL)
+        return;
+    for (; *text; text++){
+        g = glyph_index(*text);
+        glyph = &font->glyphs[g];
+        left = x - font->origins[g];
+        x += font->advances[g];
+        if (glyph->w == 0 || reserve(geometry, 4, 6) < 0)
+            continue;
+
+        u = (float)glyph->x / font->surface->w;
+        v = (float)glyph->y / font->surface->h;
+        du = (float)glyph->w / font->surface->w;
+        dv = (float)glyph->h / font->surface->h;
+        base = geometry->vertex_count;
+        q = geometry->vertices + base;
+        for (k = 0; k < 4; k++){
+            q[k].position.x = left + (k & 1 ? glyph->w : 0);
+            q[k].position.y = y + (k & 2 ? glyph->h : 0);
+            q[k].tex_coord.x = u + (k & 1 ? du : 0);
+            q[k].tex_coord.y = v + (k & 2 ? dv : 0);
+            q[k].color = c;
+        }
+        geometry->vertex_count += 4;
+
+        index = geometry->indices + geometry->index_count;
+        index[0] = base;
+        index[1] = base + 1;
+        index[2] = base + 2;
+        index[3] = base + 1;
+        index[4] = base + 3;
+        index[5] = base + 2;
+        geometry->index_count += 6;
+    }
+}
+
+void draw_face(enum Face face, int x, int y){
+    SDL_Rect pos;
+
+    flush();
+    pos.x = x;
+    pos.y = y;
+    pos.w = pos.h = 30;
+    SDL_RenderCopy(hardware.renderer, hardware.faces[face], NULL, &pos);
+    pos.x--;
+    pos.y--;
+    pos.w = pos.h = 32;
+    SDL_SetRenderDrawColor(hardware.renderer, WHITE >> 24, (WHITE >> 16) & 0xff, (WHITE >> 8) & 0xff, WHITE & 0xff);
+    SDL_RenderDrawRect(hardware.renderer, &pos);
+}
+
+// Darken what's behind menus
+void dim_screen(){
+    flush();
+    SDL_SetRenderDrawBlendMode(hardware.renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(hardware.renderer, TINT_COLOR >> 24, (TINT_COLOR >> 16) & 0xff,
+                           (TINT_COLOR >> 8) & 0xff, TINT_COLOR & 0xff);
+    SDL_RenderFillRect(hardware.renderer, NULL);
+}
+
+void begin_frame(const Game *g){
+    flush();
+    SDL_RenderCopy(hardware.renderer, hardware.background, NULL, NULL);
+}
+
+void present(){
+    flush();
+    SDL_RenderPresent(hardware.renderer);
+}
+
+// SDL_Quit() takes the renderer and the window down
+void close_display(){
+}
+
+SDL_Texture *load_texture(const char *path){
+    SDL_Surface *image = IMG_Load(path);
+    SDL_Texture *texture;
+
+    if (image == NULL)
+        quit();
+    texture = SDL_CreateTextureFromSurface(hardware.renderer, image);
+    SDL_FreeSurface(image);
+    if (texture == NULL)
+        quit();
+    return texture;
+}
+
+// White coverage in the atlas, the vertex colors tint it
+SDL_Texture *load_glyphs(GlyphAtlas *atlas, TTF_Font *font){
+    SDL_Texture *texture;
+
+    if (atlas_init(atlas, font) < 0)
+        quit();
+    texture = SDL_CreateTextureFromSurface(hardware.renderer, atlas->surface);
+    if (texture == NULL)
+        quit();
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    return texture;
+}
+
+void init(){
+    SDL_RendererInfo info;
+    SDL_DisplayMode desktop;
+    int scale = frontend.scale;
+
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK | SDL_INIT_AUDIO) < 0)
+        quit();
+    init_frontend();
+
+    // Largest whole factor fitting the desktop unless asked for one
+    if (scale <= 0){
+        scale = 1;
+        if (SDL_GetDesktopDisplayMode(0, &desktop) == 0){
+            for (scale = 4; scale > 1 && (WIDTH * scale > desktop.w || HEIGHT * scale > desktop.h); scale--)
+                ;
+        }
+    }
+    hardware.window = SDL_CreateWindow("drops", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, WIDTH * scale, HEIGHT * scale,
+                                       frontend.fullscreen ? SDL_WINDOW_FULLSCREEN_DESKTOP : SDL_WINDOW_RESIZABLE);
+    if (hardware.window == NULL)
+        quit();
+    // Prefer the GPU, the software renderer draws the same thing. Any other
+    // rate than the display one goes without vsync.
+    if (!hardware.software)
+        hardware.renderer = SDL_CreateRenderer(hardware.window, -1, SDL_RENDERER_ACCELERATED | (frontend.fps_forced ? 0 : SDL_RENDERER_PRESENTVSYNC));
+    if (hardware.renderer == NULL)
+        hardware.renderer = SDL_CreateRenderer(hardware.window, -1, SDL_RENDERER_SOFTWARE);
+    if (hardware.renderer == NULL)
+        quit();
+    // Same picture as the SDL 1.2 scaler: whole factors, nearest neighbour,
+    // black bars around
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+    SDL_RenderSetLogicalSize(hardware.renderer, WIDTH, HEIGHT);
+    SDL_RenderSetIntegerScale(hardware.renderer, SDL_TRUE);
+    SDL_GetRendererInfo(hardware.renderer, &info);
+    frontend.vsync = (info.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+    printf("%s renderer\n", info.name);
+
+    if (TTF_Init() == -1)
+        quit();
+    hardware.big_font = TTF_OpenFont("media/DroidSans.ttf", 20);
+    hardware.medium_font = TTF_OpenFont("media/DroidSans.ttf", 12);
+    hardware.big_glyphs = load_glyphs(&frontend.big_atlas, hardware.big_font);
+    hardware.medium_glyphs = load_glyphs(&frontend.medium_atlas, hardware.medium_font);
+
+    hardware.faces[FACE_GAME_OVER] = load_texture("media/gameover.png");
+    hardware.faces[FACE_HAPPY] = load_texture("media/happy.png");
+    hardware.faces[FACE_PAUSED] = load_texture("media/paused.png");
+    hardware.background = load_texture("media/bg.png");
+}
+
+int main(int argc, char *argv[])
+{
+    if (parse_options(argc, argv) < 0)
+        return 1;
+    init();
+    play();
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include "frames.h"
+
+int frames_init(FrameQueue *queue){
+    queue->writing = 0;
+    queue->ready = 1;
+    queue->reading = 2;
+    queue->fresh = queue->published = queue->stopping = 0;
+    queue->lock = SDL_CreateMutex();
+    queue->posted = SDL_CreateCond();
+    return queue->lock && queue->posted ? 0 : -1;
+}
+
+Frame *frames_write(FrameQueue *queue){
+    return &queue->frames[queue->writing];
+}
+
+void frames_publish(FrameQueue *queue){
+    int swap;
+    SDL_LockMutex(queue->lock);
+    swap = queue->ready;
+    queue->ready = queue->writing;
+    queue->writing = swap;
+    queue->fresh = 1;
+    queue->published = 1;
+    SDL_CondSignal(queue->posted);
+    SDL_UnlockMutex(queue->lock);
+}
+
+Frame *frames_take(FrameQueue *queue, int wait){
+    Frame *frame = NULL;
+    int swap;
+
+    SDL_LockMutex(queue->lock);
+    while (wait && !queue->fresh && !queue->stopping)
+        SDL_CondWait(queue->posted, queue->lock);
+    if (queue->fresh && !queue->stopping){
+        swap = queue->reading;
+        queue->reading = queue->ready;
+        queue->ready = swap;
+        queue->fresh = 0;
+        frame = &queue->frames[queue->reading];
+    }
+    SDL_UnlockMutex(queue->lock);
+    return frame;
+}
+
+Frame *frames_stop(FrameQueue *queue){
+    Frame *frame = NULL;
+
+    if (queue->lock == NULL)
+        return NULL;
+    SDL_LockMutex(queue->lock);
+    queue->stopping = 1;
+    SDL_CondSignal(queue->posted);
+    if (queue->published)
+        frame = &queue->frames[queue->fresh ? queue->ready : queue->reading];
+    SDL_UnlockMutex(queue->lock);
+    return frame;
+}
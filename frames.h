@@ -0,0 +1,44 @@
+#ifndef DROPS_FRAMES_H
+#define DROPS_FRAMES_H
+
+#include <SDL.h>
+
+#include "game.h"
+
+// Everything needed to draw a frame, copied out of the simulation
+typedef struct Frame {
+    Game current;
+    // Before the last step, drawn blended with 'current' by 'blend_alpha' (0-256)
+    Game previous;
+    int blend_alpha;
+    Uint32 clock;
+    int can_berzerk;
+    int show_profile;
+    // Oldest input event this frame is the first to show, 0 when none
+    uint64_t input_time;
+} Frame;
+
+// Triple buffer between the game loop and the renderer: the game fills one
+// frame while the renderer draws another, and the third holds the latest
+// complete one. Neither side ever waits for the other to finish a frame.
+typedef struct FrameQueue {
+    Frame frames[3];
+    int writing, ready, reading;
+    // 'ready' holds a frame the renderer did not take yet
+    int fresh;
+    int published, stopping;
+    SDL_mutex *lock;
+    SDL_cond *posted;
+} FrameQueue;
+
+int frames_init(FrameQueue *queue);
+// The frame to fill before publishing it
+Frame *frames_write(FrameQueue *queue);
+void frames_publish(FrameQueue *queue);
+// Take the latest published frame, waiting for one when 'wait' is set.
+// NULL when there's none, or once frames_stop() was called.
+Frame *frames_take(FrameQueue *queue, int wait);
+// Wake up the renderer for good, returns the latest frame or NULL
+Frame *frames_stop(FrameQueue *queue);
+
+#endif
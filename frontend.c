@@ -0,0 +1,540 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "batch.h"
+#include "frontend.h"
+#include "jobs.h"
+#include "prof.h"
+
+#ifdef _PSP_FW_VERSION
+#include <pspkernel.h>
+#endif
+
+// Simulation steps we allow ourselves to run to catch up before giving up
+#define MAX_STEPS_PER_FRAME 5
+
+Frontend frontend;
+
+Game game = { .drop_capacity = CLASSIC_DROP_CAPACITY, .enemy_capacity = CLASSIC_ENEMY_CAPACITY, .parallel = 1 };
+
+static const Uint32 bonus_colors[BONUS_TYPE_NUM] = {
+    [BONUS_TYPE_TURBO] = PLAYER_TURBO_COLOR,
+    [BONUS_TYPE_FREEZE] = WHITE,
+    [BONUS_TYPE_REPEL] = 0x00C7FBff,
+    [BONUS_TYPE_BOMB] = BLACK,
+};
+
+// How far (0-256) we are from the state before the last simulation step
+static int blend_alpha = 256;
+// That state goes straight into the frame being filled. Until the next step,
+// the last frame shown still has it.
+static const Frame *last_shown;
+static int stepped;
+
+
+static void save_previous_game(){
+    if (copy_game(&frames_write(&frontend.frames)->previous, &game) < 0)
+        quit();
+    stepped = 1;
+}
+
+// Where to draw something that went from 'from' to 'to' during the last step
+static int blend(const Frame *frame, int from, int to){
+    if (frame->current.state != GAME_STATE_PLAYING)
+        return to;
+    return from + (to - from) * frame->blend_alpha / 256;
+}
+
+// Cosmetic jitter in [0, n)
+static int shake(int n){
+    return rng_below(&frontend.shake_rng, n);
+}
+
+// Draw centered text
+static void print_center(GlyphAtlas *font, const char *text, Uint32 rgba){
+    int width = text_width(font, text), height = font->height;
+    print((WIDTH - width) / 2, (HEIGHT - height) / 2, font, text, rgba);
+}
+
+// Draw centered text with a logo
+static void print_with_logo(GlyphAtlas *font, const char *text, enum Face face){
+    int width = text_width(font, text), height = font->height;
+
+    print((WIDTH - width) / 2, (HEIGHT - height) / 2, font, text, WHITE);
+    draw_face(face, (WIDTH - width) / 2 - 40, (HEIGHT - height) / 2 - (30 - height) / 2);
+}
+
+// Rolling timings of every phase, in milliseconds
+static void draw_profile(){
+    static ProfStats stats[PROF_PHASE_NUM];
+    static uint64_t refreshed;
+    uint64_t now = timing_now_ns();
+    char msg[256];
+    int p, y = 40;
+
+    // Only compose new strings twice a second
+    if (now - refreshed > 500000000ull){
+        prof_stats(stats);
+        refreshed = now;
+    }
+    print(10, y, &frontend.medium_atlas, "ms              min     avg     p99     max", WHITE);
+    for (p = 0; p < PROF_PHASE_NUM; p++){
+        y += frontend.medium_atlas.height;
+        snprintf(msg, 256, "%-12s %7.2f %7.2f %7.2f %7.2f", prof_names[p],
+                 stats[p].min / 1e6, stats[p].avg / 1e6, stats[p].p99 / 1e6, stats[p].max / 1e6);
+        print(10, y, &frontend.medium_atlas, msg, WHITE);
+    }
+}
+
+static void render_world(const Frame *frame){
+    const Game *g = &frame->current, *p = &frame->previous;
+    char msg[256];
+    int width, i, n, x, y, size, player_x, player_y;
+    Uint32 color = 0;
+    uint64_t start = prof_begin();
+
+    begin_frame(g);
+    prof_end(PROF_BACKGROUND, start);
+    start = prof_begin();
+
+    for (n = 0; n < g->drops.slots.active_count; n++){
+        i = g->drops.slots.active[n];
+        size = g->drops.size[i];
+        if (p->drops.state[i])
+            size = blend(frame, p->drops.size[i], size);
+        switch (g->drops.state[i]){
+            case DROP_STATE_ACTIVE: color = DROP_COLOR; break;
+            case DROP_STATE_GROWING:
+            case DROP_STATE_DYING: color = DROP_FADING_COLOR; break;
+            default: break;
+        }
+        if (g->player.berzerk){
+            x = g->drops.x[i] + shake(4);
+            y = g->drops.y[i] + shake(4);
+            fill_circle(x, y, size, color);
+        }
+        else {
+            fill_circle(g->drops.x[i], g->drops.y[i], size, color);
+        }
+    }
+
+    for (n = 0; n < g->enemies.slots.active_count; n++){
+        i = g->enemies.slots.active[n];
+        x = g->enemies.x[i];
+        y = g->enemies.y[i];
+        // Don't slide across the screen when the slot got reused by a new enemy
+        if (p->enemies.state[i] && abs(p->enemies.x[i] - x) <= 4 && abs(p->enemies.y[i] - y) <= 4){
+            x = blend(frame, p->enemies.x[i], x);
+            y = blend(frame, p->enemies.y[i], y);
+        }
+        fill_circle(x, y, 2, WHITE);
+    }
+
+    player_x = blend(frame, p->player.x, g->player.x);
+    player_y = blend(frame, p->player.y, g->player.y);
+
+    if (g->player.berzerk)
+        fill_circle(player_x, player_y, g->player.size + g->player.berzerk_field, FORCE_FIELD_COLOR);
+    else if (g->player.force_field)
+        fill_circle(player_x, player_y, g->player.size + g->player.force_field, FORCE_FIELD_COLOR);
+
+    if (g->player.bonus == BONUS_TYPE_BOMB){
+        int bomb_radius = (frame->clock - g->player.bonus_start) / 10;
+        fill_circle(g->bonus.x, g->bonus.y, g->bonus.grown_size + bomb_radius, FORCE_FIELD_COLOR);
+    }
+
+    if (g->bonus.state != BONUS_STATE_INACTIVE){
+        x = g->bonus.x + shake(4);
+        y = g->bonus.y + shake(4);
+        fill_circle(x, y, g->bonus.size, bonus_colors[g->bonus.type]);
+    }
+
+    x = player_x;
+    y = player_y;
+    if (g->player.hit && (frame->clock - g->player.hit < 1000)){
+        color = WHITE;
+    }
+    else if (g->player.force_field){
+        color = PLAYER_FORCE_COLOR;
+    }
+    else if (g->player.berzerk){
+        color = BLACK;
+        x = player_x + shake(3) - 1;
+        y = player_y + shake(3) - 1;
+    }
+    else if (g->player.turbo){
+        color = PLAYER_TURBO_COLOR;
+    }
+    else {
+        color = PLAYER_COLOR;
+    }
+    fill_circle(x, y, g->player.size, color);
+    prof_end(PROF_CIRCLES, start);
+    start = prof_begin();
+
+    // The strings are only rasterized again when they change
+    snprintf(msg, 256, "LEVEL %d", g->level);
+    print(10, 10, &frontend.medium_atlas, msg, WHITE);
+
+    snprintf(msg, 256, "%d", g->player.life);
+    print(WIDTH - 100, 10, &frontend.big_atlas, msg, PLAYER_COLOR);
+
+    if (frame->can_berzerk){
+        x = WIDTH - 110 + shake(3) - 1;
+        y = 22 + shake(3) - 1;
+        fill_circle(x, y, 7, BLACK);
+    }
+    else {
+        fill_circle(WIDTH - 110, 22, 4, PLAYER_COLOR);
+    }
+
+    snprintf(msg, 256, "%d", g->player.points);
+    width = text_width(&frontend.big_atlas, msg);
+    print(WIDTH - width - 10, 10, &frontend.big_atlas, msg, WHITE);
+    prof_end(PROF_TEXT, start);
+}
+
+void redraw(const Frame *frame){
+    uint64_t start = prof_begin();
+    char msg[256];
+    render_world(frame);
+    switch (frame->current.state){
+    case GAME_STATE_START_SCREEN:
+        dim_screen();
+        print_with_logo(&frontend.big_atlas, "Press START to play", FACE_HAPPY);
+        break;
+    case GAME_STATE_PAUSED:
+        dim_screen();
+        print_with_logo(&frontend.big_atlas, "Paused", FACE_PAUSED);
+        break;
+    case GAME_STATE_PLAYING:
+        break;
+    case GAME_STATE_OVER:
+        dim_screen();
+        snprintf(msg, 256, "You scored %d points, and I'M DEAD!", frame->current.player.points);
+        print_with_logo(&frontend.big_atlas, msg, FACE_GAME_OVER);
+        break;
+    }
+    if (frame->show_profile)
+        draw_profile();
+    present();
+    prof_end(PROF_FRAME, start);
+    if (frame->input_time){
+        input_presented(&frontend.input, frame->input_time);
+        prof_end(PROF_LATENCY, frame->input_time);
+    }
+}
+
+int render_main(void *unused){
+    Frame *frame;
+    while ((frame = frames_take(&frontend.frames, 1)) != NULL)
+        redraw(frame);
+    return 0;
+}
+
+// Hand the current state over to the renderer, or draw it right away
+static void show(){
+    Frame *frame = frames_write(&frontend.frames);
+    // The renderer only reads frames, and never the one being filled. Drawn
+    // right away, the columns can stay in the game's own arena.
+    if (frontend.render_thread == NULL)
+        frame->current = game;
+    else if (copy_game(&frame->current, &game) < 0)
+        quit();
+    if (!stepped && copy_game(&frame->previous, &last_shown->previous) < 0)
+        quit();
+    last_shown = frame;
+    stepped = 0;
+    frame->blend_alpha = blend_alpha;
+    frame->clock = get_clock(&game);
+    frame->can_berzerk = can_berzerk(&game);
+    frame->show_profile = frontend.show_profile;
+    // Lost if the renderer skips this frame, it's only a measure
+    frame->input_time = input_take_unshown(&frontend.input);
+    frames_publish(&frontend.frames);
+    if (frontend.render_thread == NULL)
+        redraw(frames_take(&frontend.frames, 0));
+}
+
+static void begin_recording(){
+    if (frontend.record_path == NULL)
+        return;
+    replay_begin(&frontend.replay, &game);
+    memset(&frontend.tick, 0, sizeof(frontend.tick));
+    frontend.recording = 1;
+}
+
+static int can_rewind(){
+    return frontend.rewind.capacity && !frontend.recording && !frontend.replaying;
+}
+
+// One step of the game while playing, with the live input or the replay
+static void play_step(){
+    ReplayTick *tick = &frontend.tick;
+
+    if (frontend.replaying){
+        if (!replay_next(&frontend.replay, tick)){
+            game.state = GAME_STATE_PAUSED;
+            stop_clock(&game);
+        }
+        else {
+            replay_advance(tick, &game);
+            update_game(&game, &tick->input);
+            audio_play_events(&frontend.audio, game.events);
+        }
+        if (game.state != GAME_STATE_PLAYING){
+            printf("replay: level %d, %d points, %s\n", game.level, game.player.points,
+                   replay_matches(&frontend.replay, &game) ? "as recorded" : "different from the recording");
+            frontend.replaying = 0;
+        }
+        return;
+    }
+
+    if (can_rewind() && frontend.input.state.buttons[PSP_BUTTON_SQUARE]){
+        rewind_back(&frontend.rewind, &game);
+        return;
+    }
+    step_clock(&game);
+    if (frontend.recording){
+        tick->steps++;
+        tick->input = frontend.input.state;
+        if (replay_record(&frontend.replay, tick) < 0)
+            frontend.recording = 0;
+        tick->steps = 0;
+        tick->paused = 0;
+    }
+    update_game(&game, &frontend.input.state);
+    audio_play_events(&frontend.audio, game.events);
+    if (can_rewind())
+        rewind_push(&frontend.rewind, &game);
+    if (frontend.recording && game.state == GAME_STATE_OVER){
+        replay_save(&frontend.replay, &game, frontend.record_path);
+        frontend.recording = 0;
+    }
+}
+
+// Buttons act when they are released
+static void released(int button){
+    if (button == PSP_BUTTON_SELECT){
+        frontend.show_profile = !frontend.show_profile;
+        show();
+    }
+    switch (game.state){
+    case GAME_STATE_START_SCREEN:
+        if (button == PSP_BUTTON_START || button == PSP_BUTTON_CROSS){
+            game.state = GAME_STATE_PLAYING;
+            start_clock(&game);
+            begin_recording();
+            show();
+        }
+        break;
+    case GAME_STATE_PLAYING:
+        if (button == PSP_BUTTON_START){
+            game.state = GAME_STATE_PAUSED;
+            stop_clock(&game);
+            frontend.tick.paused = 1;
+        }
+        break;
+    case GAME_STATE_PAUSED:
+        if (button == PSP_BUTTON_START || button == PSP_BUTTON_CROSS){
+            game.state = GAME_STATE_PLAYING;
+            start_clock(&game);
+            show();
+        }
+        break;
+    case GAME_STATE_OVER:
+        if (button == PSP_BUTTON_START){
+            reset_game(&game);
+            rewind_clear(&frontend.rewind);
+            save_previous_game();
+            show();
+        }
+        break;
+    }
+}
+
+static void loop(){
+    Uint32 now, last;
+    int lag = 0, steps;
+
+    save_previous_game();
+    show();
+    last = SDL_GetTicks();
+
+    while (1){
+        uint64_t start = prof_begin();
+        int e, playing;
+        input_poll(&frontend.input);
+        prof_end(PROF_INPUT, start);
+        if (frontend.input.quit)
+            quit();
+        if (frontend.input.state.buttons[PSP_BUTTON_L] && frontend.input.state.buttons[PSP_BUTTON_R]){
+            quit();
+            return;
+        }
+
+        playing = game.state == GAME_STATE_PLAYING;
+        // Every release since the last frame counts, in the order they came
+        for (e = 0; e < frontend.input.event_count; e++){
+            if (!frontend.input.events[e].pressed)
+                released(frontend.input.events[e].button);
+        }
+
+        // Run the game at a fixed rate, whatever time rendering takes
+        now = SDL_GetTicks();
+        lag += (now - last) * TICK_RATE;
+        last = now;
+        for (steps = 0; lag >= 1000 && steps < MAX_STEPS_PER_FRAME; steps++){
+            lag -= 1000;
+            save_previous_game();
+            if (game.state == GAME_STATE_PLAYING){
+                start = prof_begin();
+                play_step();
+                input_updated(&frontend.input);
+                prof_end(PROF_UPDATE, start);
+                continue;
+            }
+            // The game being replayed does not move while paused
+            if (!frontend.replaying)
+                step_clock(&game);
+            frontend.tick.steps++;
+        }
+        // Too slow to catch up, let the game slow down rather than spiral
+        lag %= 1000;
+
+        if (playing){
+            blend_alpha = lag * 256 / 1000;
+            show();
+        }
+        // Events no frame showed are left out of the latency
+        input_take_unshown(&frontend.input);
+        if (frontend.vsync && playing)
+            pacing_mark(&frontend.pacing);
+        else
+            pacing_wait(&frontend.pacing);
+    }
+}
+
+void play(){
+    if (frontend.replaying)
+        replay_start(&frontend.replay, &game);
+    loop();
+}
+
+void quit(){
+    Frame *frame = frames_stop(&frontend.frames);
+    if (frontend.recording)
+        replay_save(&frontend.replay, &game, frontend.record_path);
+    if (frontend.render_thread){
+        SDL_WaitThread(frontend.render_thread, NULL);
+        frontend.render_thread = NULL;
+    }
+    if (frame){
+        render_world(frame);
+        dim_screen();
+        print_center(&frontend.big_atlas, "Shutting down...", WHITE);
+        present();
+    }
+    if (frontend.print_latency)
+        input_print_latency(&frontend.input);
+    pacing_print(&frontend.pacing);
+    close_display();
+    if (frontend.trace_path && prof_write_trace(frontend.trace_path) != 0)
+        perror(frontend.trace_path);
+    audio_close(&frontend.audio);
+    jobs_stop();
+    SDL_Quit();
+#ifdef _PSP_FW_VERSION
+    sceKernelExitGame();
+#else
+    exit(0);
+#endif
+}
+
+void init_frontend(){
+    if (frontend.audio_buffer && audio_open(&frontend.audio, frontend.audio_buffer) < 0)
+        fprintf(stderr, "No sound: %s\n", SDL_GetError());
+
+    frontend.joystick = SDL_JoystickOpen(0);
+    SDL_JoystickEventState(SDL_ENABLE);
+    input_init(&frontend.input, frontend.joystick);
+
+    if (reset_game(&game) < 0){
+        fprintf(stderr, "Can't allocate the game entities\n");
+        quit();
+    }
+    if (frames_init(&frontend.frames) < 0)
+        quit();
+}
+
+int parse_options(int argc, char *argv[]){
+    enum GameMode mode = GAME_MODE_CLASSIC;
+    int i, j, drop_capacity = 0, enemy_capacity = 0, threads = 1, rewind_seconds = 10;
+    uint64_t seed = time(NULL);
+    const char *replay_path = NULL;
+
+#ifdef _SC_NPROCESSORS_ONLN
+    threads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    frontend.audio_buffer = AUDIO_DEFAULT_BUFFER;
+    frontend.fps = 60;
+    batch_init();
+    for (i = 1; i < argc; i++){
+        if (!strcmp(argv[i], "--swarm"))
+            mode = GAME_MODE_SWARM;
+        else if (!strcmp(argv[i], "--drops") && i + 1 < argc)
+            drop_capacity = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--enemies") && i + 1 < argc)
+            enemy_capacity = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+            seed = strtoull(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--record") && i + 1 < argc)
+            frontend.record_path = argv[++i];
+        else if (!strcmp(argv[i], "--replay") && i + 1 < argc)
+            replay_path = argv[++i];
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+            frontend.trace_path = argv[++i];
+        else if (!strcmp(argv[i], "--latency"))
+            frontend.print_latency = 1;
+        else if (!strcmp(argv[i], "--rewind") && i + 1 < argc)
+            rewind_seconds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--audio-buffer") && i + 1 < argc)
+            frontend.audio_buffer = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--fps") && i + 1 < argc){
+            frontend.fps = atoi(argv[++i]);
+            frontend.fps_forced = 1;
+        }
+        else if (!strcmp(argv[i], "--scale") && i + 1 < argc)
+            frontend.scale = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--fullscreen"))
+            frontend.fullscreen = 1;
+        else if ((j = parse_option(argc, argv, i)) >= 0)
+            i = j;
+        else {
+            fprintf(stderr, "usage: %s [--swarm] [--drops N] [--enemies N] [--threads N] [--seed N]\n"
+                    "       [--record file] [--replay file] [--trace file] [--latency] [--rewind seconds]\n"
+                    "       [--audio-buffer frames] [--fps N] [--scale N] [--fullscreen]\n%s", argv[0], option_usage);
+            return -1;
+        }
+    }
+    configure_game(&game, mode, drop_capacity, enemy_capacity);
+    seed_game(&game, seed);
+    rng_seed(&frontend.shake_rng, seed, 1);
+    pacing_init(&frontend.pacing, frontend.fps);
+    jobs_start(threads);
+    if (rewind_seconds > 0 && rewind_init(&frontend.rewind, rewind_seconds * TICK_RATE, REWIND_BUDGET) < 0)
+        fprintf(stderr, "%s: not enough memory to rewind\n", argv[0]);
+    if (replay_path){
+        if (replay_load(&frontend.replay, replay_path) < 0){
+            fprintf(stderr, "%s: can't load %s\n", argv[0], replay_path);
+            return -1;
+        }
+        frontend.replaying = 1;
+    }
+    return 0;
+}
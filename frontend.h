@@ -0,0 +1,110 @@
+#ifndef DROPS_FRONTEND_H
+#define DROPS_FRONTEND_H
+
+#include <SDL.h>
+
+#include "audio.h"
+#include "frames.h"
+#include "game.h"
+#include "input.h"
+#include "pacing.h"
+#include "replay.h"
+#include "rewind.h"
+#include "rng.h"
+#include "text.h"
+
+#define BLACK 0x000000ff
+#define WHITE 0xf4f3d7ff
+
+#define TINT_COLOR 0x00000088
+#define BG_COLOR 0x363636ff
+#define PLAYER_COLOR 0xfd63aaff
+#define PLAYER_FORCE_COLOR 0xfd0e7cff
+#define PLAYER_TURBO_COLOR 0xffe273ff
+#define FORCE_FIELD_COLOR 0xffffff80
+#define DROP_COLOR 0x019875ff
+#define DROP_FADING_COLOR 0xa6c780ff
+
+// Pictures next to the menu messages, 30x30
+enum Face {
+    FACE_HAPPY,
+    FACE_PAUSED,
+    FACE_GAME_OVER,
+    FACE_NUM
+};
+
+// Everything but drawing and presenting, the same for the SDL 1.2 and SDL2
+// front ends
+typedef struct Frontend {
+    SDL_Joystick *joystick;
+    Input input;
+    // Print input latency statistics on exit
+    int print_latency;
+    GlyphAtlas big_atlas;
+    GlyphAtlas medium_atlas;
+    FrameQueue frames;
+    // Draws and presents the frames published by the game loop, when the
+    // front end started one
+    SDL_Thread *render_thread;
+    // Frame deadlines and intervals, reported on exit
+    Pacing pacing;
+    int fps;
+    // --fps was given, the display rate is what we get otherwise
+    int fps_forced;
+    // Presenting waits for the display, no need to sleep while playing
+    int vsync;
+    // Whole factor, picked to fit the desktop when 0
+    int scale;
+    int fullscreen;
+    // Cosmetic stream, drawing never changes how the game plays
+    Rng shake_rng;
+    // Games get recorded to record_path, or played back from a file
+    Replay replay;
+    const char *record_path;
+    int recording, replaying;
+    // What happened since the last update, for the recording
+    ReplayTick tick;
+    // Recent history, walked back while SQUARE is held. Off when recording
+    // or replaying, the game would no longer match its input.
+    Rewind rewind;
+    // Frames per audio callback, no sound at all when 0
+    int audio_buffer;
+    Audio audio;
+    // Phase timings drawn over the game, toggled with SELECT
+    int show_profile;
+    const char *trace_path;
+} Frontend;
+
+extern Frontend frontend;
+extern Game game;
+
+// Provided by each front end. parse_option() returns the index of the last
+// argument it used, -1 when argv[i] is not one of its options.
+extern const char option_usage[];
+int parse_option(int argc, char *argv[], int i);
+// Open the display and load the media, calls init_frontend() once SDL is up
+void init();
+// Start a frame of 'g' with the background
+void begin_frame(const Game *g);
+void fill_circle(int x, int y, int r, Uint32 rgba);
+void print(int x, int y, GlyphAtlas *font, const char *text, Uint32 rgba);
+// The face at (x, y) in a frame one pixel wide
+void draw_face(enum Face face, int x, int y);
+// Blur or darken what's behind menus
+void dim_screen();
+void present();
+// Release what init() opened, right before SDL_Quit()
+void close_display();
+
+// Options common to both front ends, 0 when the game can start
+int parse_options(int argc, char *argv[]);
+// Sound, input, the game and its frames
+void init_frontend();
+// Draw and present a frame
+void redraw(const Frame *frame);
+int render_main(void *unused);
+// Play until quit()
+void play();
+void quit();
+
+#endif
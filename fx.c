@@ -0,0 +1,253 @@
+#include <SDL_rotozoom.h>
+#include <SDL_gfxPrimitives.h>
+
+#include "fx.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define FX_SSE2
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(__ARM_BIG_ENDIAN)
+#include <arm_neon.h>
+#define FX_NEON
+#endif
+
+static void identity(ColorOp *op){
+    int k;
+    for (k = 0; k < 4; k++){
+        op->mul[k] = 256;
+        op->add[k] = 0;
+    }
+}
+
+// Same blend as SDL_gfx boxColor(): d + (s - d) * a / 256
+static void fold_tint(ColorOp *op, const SDL_PixelFormat *format, Uint32 rgba){
+    Uint32 a = rgba & 0xff;
+    Uint32 values[3] = { rgba >> 24, (rgba >> 16) & 0xff, (rgba >> 8) & 0xff };
+    int shifts[3] = { format->Rshift, format->Gshift, format->Bshift };
+    int c, k;
+
+    for (c = 0; c < 3; c++){
+        k = shifts[c] / 8;
+        op->add[k] = (op->add[k] * (256 - a) >> 8) + (values[c] * a >> 8);
+        op->mul[k] = op->mul[k] * (256 - a) >> 8;
+    }
+}
+
+void color_op_tint(ColorOp *op, const SDL_PixelFormat *format, Uint32 rgba){
+    identity(op);
+    fold_tint(op, format, rgba);
+}
+
+static Uint32 apply_op(const ColorOp *op, const Uint32 *sums, int n){
+    Uint32 out = 0, v;
+    int k;
+    for (k = 0; k < 4; k++){
+        v = ((sums[k] / n) * op->mul[k] >> 8) + op->add[k];
+        out |= (v > 255 ? 255 : v) << (8 * k);
+    }
+    return out;
+}
+
+// Average a block, run the color op on it and write it back everywhere
+static void pixelate_block(Uint8 *block, int pitch, int w, int h, const ColorOp *op){
+    Uint32 sums[4] = { 0, 0, 0, 0 }, color, *row;
+    int i, j;
+
+    for (j = 0; j < h; j++){
+        row = (Uint32 *)(block + j * pitch);
+        for (i = 0; i < w; i++){
+            sums[0] += row[i] & 0xff;
+            sums[1] += (row[i] >> 8) & 0xff;
+            sums[2] += (row[i] >> 16) & 0xff;
+            sums[3] += row[i] >> 24;
+        }
+    }
+    color = apply_op(op, sums, w * h);
+    for (j = 0; j < h; j++){
+        row = (Uint32 *)(block + j * pitch);
+        for (i = 0; i < w; i++)
+            row[i] = color;
+    }
+}
+
+static void tint_pixels(Uint32 *row, int w, const ColorOp *op){
+    Uint32 sums[4];
+    int i;
+    for (i = 0; i < w; i++){
+        sums[0] = row[i] & 0xff;
+        sums[1] = (row[i] >> 8) & 0xff;
+        sums[2] = (row[i] >> 16) & 0xff;
+        sums[3] = row[i] >> 24;
+        row[i] = apply_op(op, sums, 1);
+    }
+}
+
+#if defined(FX_SSE2)
+static void pixelate_block8(Uint8 *block, int pitch, const ColorOp *op){
+    __m128i zero = _mm_setzero_si128(), acc = zero, p, color;
+    __m128i mul = _mm_loadl_epi64((const __m128i *)op->mul);
+    __m128i add = _mm_loadl_epi64((const __m128i *)op->add);
+    __m128i *row;
+    int j;
+
+    // 64 pixels of at most 255 fit in 16 bit lanes
+    for (j = 0; j < 8; j++){
+        row = (__m128i *)(block + j * pitch);
+        p = _mm_loadu_si128(row);
+        acc = _mm_add_epi16(acc, _mm_unpacklo_epi8(p, zero));
+        acc = _mm_add_epi16(acc, _mm_unpackhi_epi8(p, zero));
+        p = _mm_loadu_si128(row + 1);
+        acc = _mm_add_epi16(acc, _mm_unpacklo_epi8(p, zero));
+        acc = _mm_add_epi16(acc, _mm_unpackhi_epi8(p, zero));
+    }
+    acc = _mm_add_epi16(acc, _mm_srli_si128(acc, 8));
+    acc = _mm_srli_epi16(acc, 6);
+    acc = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(acc, mul), 8), add);
+    color = _mm_shuffle_epi32(_mm_packus_epi16(acc, zero), 0);
+    for (j = 0; j < 8; j++){
+        row = (__m128i *)(block + j * pitch);
+        _mm_storeu_si128(row, color);
+        _mm_storeu_si128(row + 1, color);
+    }
+}
+
+void color_op_row(Uint32 *row, int w, const ColorOp *op){
+    __m128i zero = _mm_setzero_si128(), p, lo, hi;
+    __m128i mul = _mm_loadl_epi64((const __m128i *)op->mul);
+    __m128i add = _mm_loadl_epi64((const __m128i *)op->add);
+    int i;
+
+    mul = _mm_unpacklo_epi64(mul, mul);
+    add = _mm_unpacklo_epi64(add, add);
+    for (i = 0; i + 4 <= w; i += 4){
+        p = _mm_loadu_si128((__m128i *)(row + i));
+        lo = _mm_mullo_epi16(_mm_unpacklo_epi8(p, zero), mul);
+        hi = _mm_mullo_epi16(_mm_unpackhi_epi8(p, zero), mul);
+        lo = _mm_add_epi16(_mm_srli_epi16(lo, 8), add);
+        hi = _mm_add_epi16(_mm_srli_epi16(hi, 8), add);
+        _mm_storeu_si128((__m128i *)(row + i), _mm_packus_epi16(lo, hi));
+    }
+    tint_pixels(row + i, w - i, op);
+}
+#elif defined(FX_NEON)
+static void pixelate_block8(Uint8 *block, int pitch, const ColorOp *op){
+    uint16x8_t acc = vdupq_n_u16(0);
+    uint16x4_t sum, mul = vld1_u16(op->mul), add = vld1_u16(op->add);
+    uint32x4_t color;
+    uint8x16_t p;
+    Uint8 *row;
+    int j;
+
+    for (j = 0; j < 8; j++){
+        row = block + j * pitch;
+        p = vld1q_u8(row);
+        acc = vaddw_u8(acc, vget_low_u8(p));
+        acc = vaddw_u8(acc, vget_high_u8(p));
+        p = vld1q_u8(row + 16);
+        acc = vaddw_u8(acc, vget_low_u8(p));
+        acc = vaddw_u8(acc, vget_high_u8(p));
+    }
+    sum = vshr_n_u16(vadd_u16(vget_low_u16(acc), vget_high_u16(acc)), 6);
+    sum = vadd_u16(vshr_n_u16(vmul_u16(sum, mul), 8), add);
+    color = vdupq_n_u32(vget_lane_u32(vreinterpret_u32_u8(vqmovn_u16(vcombine_u16(sum, sum))), 0));
+    for (j = 0; j < 8; j++){
+        row = block + j * pitch;
+        vst1q_u32((uint32_t *)row, color);
+        vst1q_u32((uint32_t *)(row + 16), color);
+    }
+}
+
+void color_op_row(Uint32 *row, int w, const ColorOp *op){
+    uint16x8_t mul = vcombine_u16(vld1_u16(op->mul), vld1_u16(op->mul));
+    uint16x8_t add = vcombine_u16(vld1_u16(op->add), vld1_u16(op->add));
+    uint16x8_t lo, hi;
+    uint8x16_t p;
+    int i;
+
+    for (i = 0; i + 4 <= w; i += 4){
+        p = vld1q_u8((Uint8 *)(row + i));
+        lo = vaddq_u16(vshrq_n_u16(vmulq_u16(vmovl_u8(vget_low_u8(p)), mul), 8), add);
+        hi = vaddq_u16(vshrq_n_u16(vmulq_u16(vmovl_u8(vget_high_u8(p)), mul), 8), add);
+        vst1q_u8((Uint8 *)(row + i), vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi)));
+    }
+    tint_pixels(row + i, w - i, op);
+}
+#else
+static void pixelate_block8(Uint8 *block, int pitch, const ColorOp *op){
+    pixelate_block(block, pitch, 8, 8, op);
+}
+
+void color_op_row(Uint32 *row, int w, const ColorOp *op){
+    tint_pixels(row, w, op);
+}
+#endif
+
+// Anything but 32 bit pixels, or more than one pixelation: one full pass per
+// stage, as it used to be
+static void apply_fx_slow(SDL_Surface *surface, const FxStage *stages, int count){
+    SDL_Surface *mini, *maxi;
+    int i;
+    for (i = 0; i < count; i++){
+        switch (stages[i].fx){
+        case FX_PIXELATE:
+            if (stages[i].param < 2)
+                break;
+            mini = zoomSurface(surface, 1.0 / stages[i].param, 1.0 / stages[i].param, 1);
+            maxi = zoomSurface(mini, stages[i].param, stages[i].param, 0);
+            SDL_FreeSurface(mini);
+            SDL_BlitSurface(maxi, NULL, surface, NULL);
+            SDL_FreeSurface(maxi);
+            break;
+        case FX_TINT:
+            boxColor(surface, 0, 0, surface->w, surface->h, stages[i].param);
+            break;
+        }
+    }
+}
+
+void apply_fx(SDL_Surface *surface, const FxStage *stages, int count){
+    ColorOp op;
+    Uint8 *pixels;
+    int i, x, y, w, h, block = 1, pixelates = 0;
+
+    for (i = 0; i < count; i++)
+        pixelates += stages[i].fx == FX_PIXELATE && stages[i].param > 1;
+    // Pixelations don't fold into one another, blocks of 4 then 6 are not blocks of anything
+    if (surface->format->BytesPerPixel != 4 || pixelates > 1){
+        apply_fx_slow(surface, stages, count);
+        return;
+    }
+
+    // Averaging and blending are both linear, the order of stages doesn't matter
+    identity(&op);
+    for (i = 0; i < count; i++){
+        switch (stages[i].fx){
+        case FX_PIXELATE:
+            block = stages[i].param > 1 ? stages[i].param : 1;
+            break;
+        case FX_TINT:
+            fold_tint(&op, surface->format, stages[i].param);
+            break;
+        }
+    }
+
+    if (SDL_MUSTLOCK(surface) && SDL_LockSurface(surface) < 0)
+        return;
+    pixels = surface->pixels;
+    for (y = 0; y < surface->h; y += block){
+        h = surface->h - y < block ? surface->h - y : block;
+        if (block == 1){
+            color_op_row((Uint32 *)(pixels + y * surface->pitch), surface->w, &op);
+            continue;
+        }
+        for (x = 0; x < surface->w; x += block){
+            w = surface->w - x < block ? surface->w - x : block;
+            if (w == 8 && h == 8)
+                pixelate_block8(pixels + y * surface->pitch + x * 4, surface->pitch, &op);
+            else
+                pixelate_block(pixels + y * surface->pitch + x * 4, surface->pitch, w, h, &op);
+        }
+    }
+    if (SDL_MUSTLOCK(surface))
+        SDL_UnlockSurface(surface);
+}
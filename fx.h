@@ -0,0 +1,35 @@
+#ifndef DROPS_FX_H
+#define DROPS_FX_H
+
+#include <SDL.h>
+
+typedef enum FX {
+    // param: block size in pixels
+    FX_PIXELATE,
+    // param: RGBA color blended over everything
+    FX_TINT,
+} FX;
+
+// For each byte of a 32 bit pixel: out = min(255, (in * mul >> 8) + add)
+typedef struct ColorOp {
+    Uint16 mul[4];
+    Uint16 add[4];
+} ColorOp;
+
+typedef struct FxStage {
+    FX fx;
+    Uint32 param;
+} FxStage;
+
+// Run a chain of effects over a surface in a single pass, in place. Color
+// effects are folded together and applied once per block, so adding stages
+// doesn't add full frame passes. A chain with more than one pixelate stage
+// falls back to a pass per stage.
+void apply_fx(SDL_Surface *surface, const FxStage *stages, int count);
+
+// The op blending 'rgba' over pixels of 'format', as boxColor() does
+void color_op_tint(ColorOp *op, const SDL_PixelFormat *format, Uint32 rgba);
+// Run an op over a row of 32 bit pixels, with SSE2 or NEON when available
+void color_op_row(Uint32 *row, int w, const ColorOp *op);
+
+#endif
@@ -0,0 +1,587 @@
+#include <string.h>
+
+#include "batch.h"
+#include "game.h"
+#include "jobs.h"
+
+// Columns start on their own cache line
+#define COLUMN_ALIGN 64
+// Entities per job chunk, smaller ones cost more to hand out than to run
+#define CHUNK_SIZE 1024
+
+int collide(int x1, int y1, int size1, int x2, int y2, int size2){
+    int sqd = (x1 - x2) * (x1 - x2) + (y1 - y2) * (y1 - y2);
+    return sqd < (size1 + size2) * (size1 + size2);
+}
+
+int keep_inside(int v, int min, int max){
+    if (v < min)
+        return min;
+    if (v > max)
+        return max;
+    return v;
+}
+
+void step_clock(Game *g){
+    g->sim_fraction += 1000;
+    g->sim_ticks += g->sim_fraction / TICK_RATE;
+    g->sim_fraction %= TICK_RATE;
+}
+
+void stop_clock(Game *g){
+    g->ticks += g->sim_ticks - g->last_start;
+    g->last_start = 0;
+}
+
+void start_clock(Game *g){
+    g->last_start = g->sim_ticks;
+}
+
+Uint32 get_clock(const Game *g){
+    if (g->state == GAME_STATE_PLAYING){
+        return g->ticks + g->sim_ticks - g->last_start;
+    }
+    else {
+        return g->ticks;
+    }
+}
+
+int can_berzerk(const Game *g){
+    return g->player.energy > 500;
+}
+
+static void reset_slots(SlotList *slots, int capacity){
+    int i;
+    slots->active_count = 0;
+    slots->free_count = 0;
+    slots->high = 0;
+    // Stacked backwards so that slot 0 is handed out first
+    for (i = capacity - 1; i >= 0; i--){
+        slots->where[i] = -1;
+        slots->free[slots->free_count++] = i;
+    }
+}
+
+static int take_slot(SlotList *slots){
+    int i;
+    if (slots->free_count == 0)
+        return -1;
+    i = slots->free[--slots->free_count];
+    slots->where[i] = slots->active_count;
+    slots->active[slots->active_count++] = i;
+    if (i >= slots->high)
+        slots->high = i + 1;
+    return i;
+}
+
+// The last live slot takes the place of the released one, so walking
+// 'active' backwards is safe while releasing
+static void release_slot(SlotList *slots, int i){
+    int last = slots->active[--slots->active_count];
+    slots->active[slots->where[i]] = last;
+    slots->where[last] = slots->where[i];
+    slots->where[i] = -1;
+    slots->free[slots->free_count++] = i;
+}
+
+int spawn_drop(Game *g, int x, int y){
+    int i = take_slot(&g->drops.slots);
+    if (i >= 0){
+        g->drops.state[i] = DROP_STATE_GROWING;
+        g->drops.x[i] = x;
+        g->drops.y[i] = y;
+        grid_insert(&g->drops.grid, i, x, y);
+    }
+    return i;
+}
+
+void kill_drop(Game *g, int i){
+    g->drops.state[i] = DROP_STATE_INACTIVE;
+    grid_remove(&g->drops.grid, i);
+    release_slot(&g->drops.slots, i);
+}
+
+int spawn_enemy(Game *g, int x, int y){
+    int i = take_slot(&g->enemies.slots);
+    if (i >= 0){
+        g->enemies.state[i] = ENEMY_STATE_ACTIVE;
+        g->enemies.x[i] = x;
+        g->enemies.y[i] = y;
+        grid_insert(&g->enemies.grid, i, x, y);
+    }
+    return i;
+}
+
+void kill_enemy(Game *g, int i){
+    g->enemies.state[i] = ENEMY_STATE_INACTIVE;
+    g->enemies.speed[i] = 0;
+    grid_remove(&g->enemies.grid, i);
+    release_slot(&g->enemies.slots, i);
+}
+
+typedef struct CircleJob {
+    Game *g;
+    int x, y, reach;
+} CircleJob;
+
+typedef struct AbsorbJob {
+    Game *g;
+    const int *candidates;
+    int gained;
+} AbsorbJob;
+
+static void collide_chunk(void *data, int begin, int end){
+    const CircleJob *circle = data;
+    Enemies *enemies = &circle->g->enemies;
+    collide_batch(circle->x, circle->y, circle->reach, enemies->x + begin, enemies->y + begin, ENEMY_SIZE, end - begin, enemies->hit + begin);
+}
+
+static void chase_chunk(void *data, int begin, int end){
+    Game *g = data;
+    Enemies *enemies = &g->enemies;
+    chase_batch(enemies->x + begin, enemies->y + begin, enemies->speed + begin, end - begin, g->player.x, g->player.y);
+}
+
+// Over places in 'active', dead drops are released afterwards
+static void grow_chunk(void *data, int begin, int end){
+    Game *g = data;
+    Drops *drops = &g->drops;
+    int n, i;
+    for (n = begin; n < end; n++){
+        i = drops->slots.active[n];
+        if (drops->state[i] == DROP_STATE_GROWING){
+            drops->size[i]++;
+            if (drops->size[i] >= drops->grown_size[i]){
+                drops->state[i] = DROP_STATE_ACTIVE;
+                drops->size[i] = drops->grown_size[i];
+            }
+        }
+        else if (drops->state[i] == DROP_STATE_DYING){
+            drops->size[i]--;
+        }
+    }
+}
+
+// Integer sums, the total is the same whatever order chunks finish in
+static void absorb_chunk(void *data, int begin, int end){
+    AbsorbJob *absorb = data;
+    Game *g = absorb->g;
+    Drops *drops = &g->drops;
+    int n, i, gained = 0;
+    for (n = begin; n < end; n++){
+        i = absorb->candidates[n];
+        if (drops->state[i] != DROP_STATE_DYING){
+            if (collide(g->player.x, g->player.y, g->player.size, drops->x[i], drops->y[i], drops->size[i])){
+                gained += drops->size[i];
+                drops->state[i] = DROP_STATE_DYING;
+            }
+        }
+    }
+    __atomic_fetch_add(&absorb->gained, gained, __ATOMIC_RELAXED);
+}
+
+// Games run on a worker must not hand out jobs themselves, the pool is busy
+static void run_chunks(const Game *g, JobFunc fn, void *data, int count){
+    if (g->parallel)
+        jobs_run(fn, data, count, CHUNK_SIZE);
+    else if (count > 0)
+        fn(data, 0, count);
+}
+
+static int by_position_descending(const void *a, const void *b){
+    return *(const int *)b - *(const int *)a;
+}
+
+// Enemies within reach of (x, y), as their places in 'active' from the last
+// one. Killing them in that order is the same as the backward walk of the
+// whole list: released places are only refilled from already seen ones.
+static int enemies_within(Game *g, int x, int y, int reach){
+    Enemies *enemies = &g->enemies;
+    int *found = enemies->grid.found;
+    int n, i, count, hits = 0;
+    CircleJob circle = { g, x, y, reach };
+
+    // Testing them all at once is cheaper than visiting mostly empty cells
+    if (grid_cells(x, y, reach + ENEMY_SIZE) >= enemies->slots.active_count){
+        run_chunks(g, collide_chunk, &circle, enemies->slots.high);
+        for (n = enemies->slots.active_count - 1; n >= 0; n--){
+            if (enemies->hit[enemies->slots.active[n]])
+                found[hits++] = n;
+        }
+        return hits;
+    }
+
+    count = grid_query(&enemies->grid, x, y, reach + ENEMY_SIZE);
+    for (n = 0; n < count; n++){
+        i = found[n];
+        if (collide(x, y, reach, enemies->x[i], enemies->y[i], ENEMY_SIZE))
+            found[hits++] = enemies->slots.where[i];
+    }
+    qsort(found, hits, sizeof(int), by_position_descending);
+    return hits;
+}
+
+void configure_game(Game *g, enum GameMode mode, int drop_capacity, int enemy_capacity){
+    g->mode = mode;
+    g->drop_capacity = drop_capacity > 0 ? drop_capacity : mode == GAME_MODE_SWARM ? SWARM_DROP_CAPACITY : CLASSIC_DROP_CAPACITY;
+    g->enemy_capacity = enemy_capacity > 0 ? enemy_capacity : mode == GAME_MODE_SWARM ? SWARM_ENEMY_CAPACITY : CLASSIC_ENEMY_CAPACITY;
+}
+
+// Carve the next column out of the arena, or just count when there's none
+static void *carve(Uint8 *arena, size_t *used, int count, size_t size){
+    void *column = arena ? arena + *used : NULL;
+    *used += (count * size + COLUMN_ALIGN - 1) & ~(size_t)(COLUMN_ALIGN - 1);
+    return column;
+}
+
+// Point every column of g into arena, returns the bytes they need
+static size_t layout_game(Game *g, Uint8 *arena){
+    size_t used = 0;
+    int drops = g->drop_capacity, enemies = g->enemy_capacity;
+
+    g->drops.slots.capacity = drops;
+    g->drops.slots.active = carve(arena, &used, drops, sizeof(int));
+    g->drops.slots.where = carve(arena, &used, drops, sizeof(int));
+    g->drops.slots.free = carve(arena, &used, drops, sizeof(int));
+    g->drops.state = carve(arena, &used, drops, sizeof(int));
+    g->drops.x = carve(arena, &used, drops, sizeof(int));
+    g->drops.y = carve(arena, &used, drops, sizeof(int));
+    g->drops.size = carve(arena, &used, drops, sizeof(int));
+    g->drops.grown_size = carve(arena, &used, drops, sizeof(int));
+    g->drops.grid.cell = carve(arena, &used, drops, sizeof(int));
+    g->drops.grid.next = carve(arena, &used, drops, sizeof(int));
+    g->drops.grid.prev = carve(arena, &used, drops, sizeof(int));
+    g->drops.grid.found = carve(arena, &used, drops, sizeof(int));
+
+    g->enemies.slots.capacity = enemies;
+    g->enemies.slots.active = carve(arena, &used, enemies, sizeof(int));
+    g->enemies.slots.where = carve(arena, &used, enemies, sizeof(int));
+    g->enemies.slots.free = carve(arena, &used, enemies, sizeof(int));
+    g->enemies.state = carve(arena, &used, enemies, sizeof(int));
+    g->enemies.x = carve(arena, &used, enemies, sizeof(int));
+    g->enemies.y = carve(arena, &used, enemies, sizeof(int));
+    g->enemies.grid.cell = carve(arena, &used, enemies, sizeof(int));
+    g->enemies.grid.next = carve(arena, &used, enemies, sizeof(int));
+    g->enemies.grid.prev = carve(arena, &used, enemies, sizeof(int));
+    g->enemies.grid.found = carve(arena, &used, enemies, sizeof(int));
+    g->enemies.speed = carve(arena, &used, enemies, sizeof(int));
+    g->enemies.hit = carve(arena, &used, enemies, 1);
+    return used;
+}
+
+// Only allocates when the capacities grew, 'size' gets the bytes in use
+static int size_arena(Game *g, size_t *size){
+    *size = layout_game(g, NULL);
+    if (g->arena == NULL || g->arena_size < *size){
+        free(g->arena);
+        g->arena = malloc(*size);
+        g->arena_size = g->arena ? *size : 0;
+        if (g->arena == NULL)
+            return -1;
+    }
+    layout_game(g, g->arena);
+    return 0;
+}
+
+int copy_game(Game *dst, const Game *src){
+    void *arena = dst->arena;
+    size_t arena_size = dst->arena_size, size;
+
+    *dst = *src;
+    dst->arena = arena;
+    dst->arena_size = arena_size;
+    if (size_arena(dst, &size) < 0)
+        return -1;
+    memcpy(dst->arena, src->arena, size);
+    return 0;
+}
+
+void relayout_game(Game *g){
+    layout_game(g, g->arena);
+}
+
+void free_game(Game *g){
+    free(g->arena);
+    g->arena = NULL;
+    g->arena_size = 0;
+}
+
+void seed_game(Game *g, uint64_t seed){
+    g->seed = seed;
+    rng_seed(&g->rng, seed, 0);
+}
+
+int reset_game(Game *g){
+    int i;
+    size_t size;
+    if (size_arena(g, &size) < 0)
+        return -1;
+    // Never seeded, a zero generator would only give zeros
+    if (g->rng.inc == 0)
+        seed_game(g, 0);
+    g->level = 1;
+    g->player.x = WIDTH / 2;
+    g->player.y = HEIGHT / 2;
+    g->player.life = 5;
+    g->player.size = 10;
+    g->player.speed = 2;
+    g->player.turbo = 0;
+    g->player.energy = 0;
+    g->player.force_field = 0;
+    g->player.points = 0;
+    g->player.hit = 0;
+    g->player.bonus = BONUS_TYPE_NONE;
+    g->player.bonus_start = 0;
+    reset_slots(&g->drops.slots, g->drop_capacity);
+    for (i = 0; i < g->drop_capacity; i++){
+        g->drops.state[i] = DROP_STATE_INACTIVE;
+    }
+    reset_slots(&g->enemies.slots, g->enemy_capacity);
+    for (i = 0; i < g->enemy_capacity; i++){
+        g->enemies.state[i] = ENEMY_STATE_INACTIVE;
+        g->enemies.speed[i] = 0;
+    }
+    grid_clear(&g->drops.grid);
+    grid_clear(&g->enemies.grid);
+    g->bonus.state = BONUS_STATE_INACTIVE;
+    g->state = GAME_STATE_START_SCREEN;
+    g->last_enemy_timestamp = 0;
+    g->ticks = 0;
+    g->last_start = 0;
+    return 0;
+}
+
+void update_game(Game *g, const JoystickState *input){
+    int dx = 0, dy = 0, i, n, wave, found, hits, reach, x, y, size;
+    AbsorbJob absorb;
+    int max_active_drops_count, max_active_enemies_count, enemies_per_wave;
+    Drops *drops = &g->drops;
+    Enemies *enemies = &g->enemies;
+    Uint32 berzerk_duration;
+
+    g->events = 0;
+    if (g->mode == GAME_MODE_SWARM){
+        max_active_drops_count = keep_inside(100 + g->level * 20, 5, g->drop_capacity);
+        max_active_enemies_count = keep_inside(250 * g->level, 0, g->enemy_capacity);
+        enemies_per_wave = 25 * g->level;
+    }
+    else {
+        max_active_drops_count = keep_inside(20 - (g->level / 2), 5, g->drop_capacity);
+        max_active_enemies_count = keep_inside(10 + g->level * 2, 0, g->enemy_capacity);
+        enemies_per_wave = 1;
+    }
+
+    // Did we reach the end of the bonus ?
+    if (g->player.bonus != BONUS_TYPE_NONE){
+        Uint32 bonus_duration = get_clock(g) - g->player.bonus_start;
+        if (bonus_duration > 3000){
+            g->player.bonus = BONUS_TYPE_NONE;
+        }
+    }
+
+    if (can_berzerk(g) && input->buttons[PSP_BUTTON_TRIANGLE] && !g->player.berzerk){
+        g->player.energy = 0;
+        g->player.berzerk = get_clock(g);
+        g->player.berzerk_field = 0;
+        g->events |= GAME_EVENT_BERZERK;
+        return;
+    }
+
+    if (g->player.berzerk){
+        berzerk_duration = get_clock(g) - g->player.berzerk;
+        g->player.berzerk_field = berzerk_duration / 4;
+        if (berzerk_duration > 1500){
+            g->player.berzerk = 0;
+        }
+    }
+
+    // let the drops grow or die
+    run_chunks(g, grow_chunk, g, drops->slots.active_count);
+    for (n = drops->slots.active_count - 1; n >= 0; n--){
+        i = drops->slots.active[n];
+        if (drops->state[i] == DROP_STATE_DYING && drops->size[i] <= 1){
+            kill_drop(g, i);
+        }
+    }
+
+    if (g->bonus.state == BONUS_STATE_GROWING){
+        g->bonus.size++;
+        if (g->bonus.size >= g->bonus.grown_size){
+            g->bonus.state = BONUS_STATE_ACTIVE;
+            g->bonus.size = g->bonus.grown_size;
+        }
+    }
+    else if (g->bonus.state == BONUS_STATE_DYING){
+        g->bonus.size--;
+        if (g->bonus.size <= 1){
+            g->bonus.state = BONUS_STATE_INACTIVE;
+        }
+    }
+
+
+    // Add drops if maximum not reached
+    while (drops->slots.active_count < max_active_drops_count){
+        size = 5 + rng_below(&g->rng, 30 - g->level);
+        x = size + rng_below(&g->rng, WIDTH - 2 * size);
+        y = size + rng_below(&g->rng, HEIGHT - 2 * size);
+        if ((i = spawn_drop(g, x, y)) < 0)
+            break;
+        drops->grown_size[i] = size;
+        drops->size[i] = 1;
+    }
+
+    // Do we absorb a drop ?
+    reach = g->player.size + DROP_MAX_SIZE;
+    if (grid_cells(g->player.x, g->player.y, reach) >= drops->slots.active_count){
+        absorb.candidates = drops->slots.active;
+        found = drops->slots.active_count;
+    }
+    else {
+        absorb.candidates = drops->grid.found;
+        found = grid_query(&drops->grid, g->player.x, g->player.y, reach);
+    }
+    absorb.g = g;
+    absorb.gained = 0;
+    run_chunks(g, absorb_chunk, &absorb, found);
+    g->player.points += absorb.gained;
+    g->player.energy += absorb.gained;
+    if (absorb.gained)
+        g->events |= GAME_EVENT_DROP;
+
+    // Did we absorb the bonus ?
+    if (g->bonus.state != BONUS_STATE_INACTIVE && g->bonus.state != BONUS_STATE_DYING){
+        if (collide(g->player.x, g->player.y, g->player.size, g->bonus.x, g->bonus.y, g->bonus.size)){
+            g->player.bonus = g->bonus.type;
+            g->player.bonus_start = get_clock(g);
+            g->bonus.state = BONUS_STATE_DYING;
+            g->events |= g->bonus.type == BONUS_TYPE_BOMB ? GAME_EVENT_BOMB : GAME_EVENT_BONUS;
+        }
+    }
+
+    // Did the Bomb Bonus explode ?
+    if (g->player.bonus == BONUS_TYPE_BOMB){
+        int bomb_radius = (get_clock(g) - g->player.bonus_start) / 10;
+        hits = enemies_within(g, g->bonus.x, g->bonus.y, g->bonus.grown_size + bomb_radius);
+        for (n = 0; n < hits; n++){
+            kill_enemy(g, enemies->slots.active[enemies->grid.found[n]]);
+        }
+    }
+
+    // Do we need to interact with enemies ?
+    reach = g->player.size;
+    if (g->player.berzerk && g->player.berzerk_field > reach - g->player.size)
+        reach = g->player.size + g->player.berzerk_field;
+    if (g->player.force_field > reach - g->player.size)
+        reach = g->player.size + g->player.force_field;
+    hits = enemies_within(g, g->player.x, g->player.y, reach);
+    for (n = 0; n < hits; n++){
+        i = enemies->slots.active[enemies->grid.found[n]];
+        // We get hurt if we collide with enemies..
+        if (collide(g->player.x, g->player.y, g->player.size, enemies->x[i], enemies->y[i], 2)){
+            g->player.hit = get_clock(g);
+            g->player.life--;
+            g->events |= GAME_EVENT_HIT;
+            kill_enemy(g, i);
+            if (g->player.life == 0){
+                g->state = GAME_STATE_OVER;
+                stop_clock(g);
+                return;
+            }
+        }
+        // ..unless we GO BERZERK
+        else if (g->player.berzerk && collide(g->player.x, g->player.y, g->player.size +  + (g->player.berzerk ? g->player.berzerk_field : 0), enemies->x[i], enemies->y[i], 2)){
+            kill_enemy(g, i);
+        }
+        // ..unless we USE THE FORCE
+        else if (g->player.force_field && collide(g->player.x, g->player.y, g->player.size + g->player.force_field, enemies->x[i], enemies->y[i], 2)){
+            kill_enemy(g, i);
+        }
+    }
+
+    // Make the Enemies chase us
+    if (!g->player.berzerk && g->player.bonus != BONUS_TYPE_FREEZE){
+        int direction = (g->player.bonus != BONUS_TYPE_REPEL) * 2 - 1;
+        // One coin flip per slot, the free ones stay still
+        rng_fill_bits(&g->rng, enemies->speed, enemies->slots.high);
+        for (i = 0; i < enemies->slots.high; i++)
+            enemies->speed[i] = enemies->state[i] == ENEMY_STATE_ACTIVE ? direction * (enemies->speed[i] + 1) : 0;
+        run_chunks(g, chase_chunk, g, enemies->slots.high);
+        for (n = 0; n < enemies->slots.active_count; n++){
+            i = enemies->slots.active[n];
+            grid_move(&enemies->grid, i, enemies->x[i], enemies->y[i]);
+        }
+    }
+
+    // Add Enemies every 0.5s unless max reached
+    if (!g->player.berzerk){
+        if ((get_clock(g) - g->last_enemy_timestamp > 500) && enemies->slots.active_count < max_active_enemies_count){
+            for (wave = 0; wave < enemies_per_wave && enemies->slots.active_count < max_active_enemies_count; wave++){
+                x = rng_below(&g->rng, 2) ? 10 : WIDTH - 10;
+                y = rng_below(&g->rng, 2) ? 10 : HEIGHT - 10;
+                if (spawn_enemy(g, x, y) < 0)
+                    break;
+                g->last_enemy_timestamp = get_clock(g);
+            }
+        }
+    }
+
+    // Use turbo ?
+    g->player.speed = 2;
+    g->player.turbo = 0;
+    if (g->player.bonus == BONUS_TYPE_TURBO
+        || input->buttons[PSP_BUTTON_CIRCLE]
+        || input->buttons[PSP_BUTTON_R]){
+        if (g->player.bonus != BONUS_TYPE_TURBO && g->player.energy > 0){
+            --g->player.energy;
+            g->player.speed = 4;
+            g->player.turbo = 1;
+        }
+        if (g->player.bonus == BONUS_TYPE_TURBO){
+            g->player.speed = 4;
+            g->player.turbo = 1;
+        }
+    }
+
+    // Move
+    if (input->analog_x < 120)
+       dx = -g->player.speed;
+    if (input->analog_x > 130)
+       dx = g->player.speed;
+    if (input->analog_y < 120)
+       dy = -g->player.speed;
+    if (input->analog_y > 130)
+       dy = g->player.speed;
+    if (!g->player.berzerk){
+        g->player.x += dx;
+        g->player.y += dy;
+        g->player.x = keep_inside(g->player.x, g->player.size, WIDTH - g->player.size);
+        g->player.y = keep_inside(g->player.y, g->player.size, HEIGHT - g->player.size);
+    }
+
+    // USE THE FORCE ?
+    if (input->buttons[PSP_BUTTON_CROSS] && g->player.energy){
+        if (g->player.force_field == 0)
+            g->events |= GAME_EVENT_FORCE_FIELD;
+        --g->player.energy;
+        g->player.force_field++;
+    }
+    else {
+        g->player.force_field--;
+    }
+    g->player.force_field = keep_inside(g->player.force_field, 0, 20);
+
+
+    // Next Level ?
+    if (g->player.points > (g->level << 1) * 500){
+        if (g->level < 20)
+            g->events |= GAME_EVENT_LEVEL;
+        g->level = keep_inside(g->level + 1, 1, 20);
+        // Add Bonus
+        g->bonus.state = BONUS_STATE_GROWING;
+        g->bonus.type = rng_below(&g->rng, BONUS_TYPE_NUM);
+        g->bonus.grown_size = 10;
+        g->bonus.size = 1;
+        g->bonus.x = g->bonus.grown_size + rng_below(&g->rng, WIDTH - 2 * g->bonus.grown_size);
+        g->bonus.y = g->bonus.grown_size + rng_below(&g->rng, HEIGHT - 2 * g->bonus.grown_size);
+    }
+}
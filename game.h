@@ -0,0 +1,235 @@
+#ifndef DROPS_GAME_H
+#define DROPS_GAME_H
+
+#include <stdlib.h>
+
+#ifdef DROPS_HEADLESS
+#include <stdint.h>
+typedef uint8_t Uint8;
+typedef uint32_t Uint32;
+#else
+#include <SDL.h>
+#endif
+
+#include "grid.h"
+#include "rng.h"
+
+#define WIDTH 480
+#define HEIGHT 272
+
+// The rules move things by a fixed amount per update, this many times a second
+#define TICK_RATE 60
+
+#ifdef _PSP_FW_VERSION
+enum {
+    PSP_BUTTON_CROSS,
+    PSP_BUTTON_TRIANGLE,
+    PSP_BUTTON_SQUARE,
+    PSP_BUTTON_CIRCLE,
+    PSP_BUTTON_L,
+    PSP_BUTTON_R,
+    PSP_BUTTON_DOWN,
+    PSP_BUTTON_LEFT,
+    PSP_BUTTON_UP,
+    PSP_BUTTON_RIGHT,
+    PSP_BUTTON_SELECT,
+    PSP_BUTTON_START,
+};
+#else
+// Only valid for my joypad
+enum {
+    PSP_BUTTON_CROSS = 2,
+    PSP_BUTTON_CIRCLE = 1,
+    PSP_BUTTON_SQUARE = 3,
+    PSP_BUTTON_TRIANGLE = 0,
+    PSP_BUTTON_L = 6,
+    PSP_BUTTON_R = 7,
+    PSP_BUTTON_DOWN,
+    PSP_BUTTON_LEFT,
+    PSP_BUTTON_UP,
+    PSP_BUTTON_RIGHT,
+    PSP_BUTTON_SELECT = 8,
+    PSP_BUTTON_START = 11
+};
+#endif
+
+typedef struct JoystickState {
+    int buttons[12];
+    int analog_x;
+    int analog_y;
+} JoystickState;
+
+enum BonusState {
+    BONUS_STATE_INACTIVE = 0,
+    BONUS_STATE_GROWING,
+    BONUS_STATE_ACTIVE,
+    BONUS_STATE_DYING
+};
+
+enum BonusType {
+    BONUS_TYPE_NONE = -1,
+    BONUS_TYPE_TURBO,
+    BONUS_TYPE_FREEZE,
+    BONUS_TYPE_REPEL,
+    BONUS_TYPE_BOMB,
+    BONUS_TYPE_NUM
+};
+
+typedef struct Bonus {
+    enum BonusState state;
+    enum BonusType type;
+    int x, y;
+    int size;
+    int grown_size;
+} Bonus;
+
+enum DropState {
+    DROP_STATE_INACTIVE = 0,
+    DROP_STATE_GROWING,
+    DROP_STATE_ACTIVE,
+    DROP_STATE_DYING
+};
+
+enum GameMode {
+    GAME_MODE_CLASSIC,
+    // Stress workload: thousands of enemies, hundreds of drops
+    GAME_MODE_SWARM
+};
+
+#define CLASSIC_DROP_CAPACITY 50
+#define CLASSIC_ENEMY_CAPACITY 50
+#define SWARM_DROP_CAPACITY 500
+#define SWARM_ENEMY_CAPACITY 5000
+
+// Live slots listed densely in 'active', free ones stacked in 'free', so
+// spawning, killing and walking the live entities are O(active)
+typedef struct SlotList {
+    int *active;
+    // Index of each live slot in 'active', -1 when free
+    int *where;
+    int *free;
+    int capacity, active_count, free_count;
+    // Every live slot is below it, so whole columns can be batched up to there
+    int high;
+} SlotList;
+
+// Entities are stored by column, in the game arena
+// Drops grow up to 5 + a random value below 30 - level
+#define DROP_MAX_SIZE 34
+#define ENEMY_SIZE 2
+
+typedef struct Drops {
+    SlotList slots;
+    Grid grid;
+    enum DropState *state;
+    int *x, *y;
+    int *size;
+    int *grown_size;
+} Drops;
+
+enum EnemyState {
+    ENEMY_STATE_INACTIVE = 0,
+    ENEMY_STATE_ACTIVE
+};
+
+typedef struct Enemies {
+    SlotList slots;
+    Grid grid;
+    int *state;
+    int *x, *y;
+    // Chase speed of the current update, 0 for free slots
+    int *speed;
+    // Scratch for collide_batch()
+    unsigned char *hit;
+} Enemies;
+
+typedef struct Player {
+    int x, y;
+    int size;
+    int life;
+    int turbo;
+    int speed;
+    int force_field;
+    int energy;
+    int points;
+    Uint32 hit;
+    Uint32 berzerk;
+    int berzerk_field;
+    enum BonusType bonus;
+    Uint32 bonus_start;
+} Player;
+
+// What happened during the last update_game(), for sound and effects
+enum GameEvent {
+    GAME_EVENT_DROP = 1 << 0,
+    GAME_EVENT_HIT = 1 << 1,
+    GAME_EVENT_FORCE_FIELD = 1 << 2,
+    GAME_EVENT_BERZERK = 1 << 3,
+    GAME_EVENT_BONUS = 1 << 4,
+    GAME_EVENT_BOMB = 1 << 5,
+    GAME_EVENT_LEVEL = 1 << 6,
+    GAME_EVENT_NUM = 7
+};
+
+enum GameState {
+    GAME_STATE_START_SCREEN,
+    GAME_STATE_PLAYING,
+    GAME_STATE_PAUSED,
+    GAME_STATE_OVER
+};
+
+typedef struct Game {
+    int state;
+    enum GameMode mode;
+    int level;
+    Drops drops;
+    Enemies enemies;
+    Player player;
+    Bonus bonus;
+    Uint32 last_enemy_timestamp;
+    // GAME_EVENT_* bits of the last update
+    Uint32 events;
+    Uint32 ticks, last_start;
+    // Milliseconds of simulated time, moved by step_clock() once per update
+    Uint32 sim_ticks, sim_fraction;
+    // Every random choice of the rules comes from here
+    Rng rng;
+    uint64_t seed;
+    // Wanted capacities, the arena is sized for them by reset_game()
+    int drop_capacity, enemy_capacity;
+    void *arena;
+    size_t arena_size;
+    // Spread the big loops over the job pool. Leave it off for games that
+    // already run on a worker, jobs_run() is not reentrant.
+    int parallel;
+} Game;
+
+// Everything below works on the Game it is given, so any number of them can
+// run side by side. A zeroed Game is ready for configure_game().
+int collide(int x1, int y1, int size1, int x2, int y2, int size2);
+int keep_inside(int v, int min, int max);
+// One update worth of simulated time, 1000 / TICK_RATE ms
+void step_clock(Game *g);
+void stop_clock(Game *g);
+void start_clock(Game *g);
+Uint32 get_clock(const Game *g);
+int can_berzerk(const Game *g);
+// Spawned entities are placed in their grid right away
+int spawn_drop(Game *g, int x, int y);
+void kill_drop(Game *g, int i);
+int spawn_enemy(Game *g, int x, int y);
+void kill_enemy(Game *g, int i);
+// 0 capacities pick the mode defaults, applied on the next reset_game()
+void configure_game(Game *g, enum GameMode mode, int drop_capacity, int enemy_capacity);
+int reset_game(Game *g);
+// Restart the random sequence of the rules, it is not reset with the game
+void seed_game(Game *g, uint64_t seed);
+// Deep copy, the columns included. dst must be zeroed or a previous copy.
+int copy_game(Game *dst, const Game *src);
+// Point the columns back into g's own arena, after the struct was
+// overwritten with a copy. With no arena, they are all set to NULL.
+void relayout_game(Game *g);
+void free_game(Game *g);
+void update_game(Game *g, const JoystickState *input);
+
+#endif
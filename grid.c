@@ -0,0 +1,71 @@
+#include "grid.h"
+
+static int clamp(int v, int max){
+    if (v < 0)
+        return 0;
+    if (v > max)
+        return max;
+    return v;
+}
+
+static int column_of(int x){
+    return clamp(x >> GRID_SHIFT, GRID_COLUMNS - 1);
+}
+
+static int row_of(int y){
+    return clamp(y >> GRID_SHIFT, GRID_ROWS - 1);
+}
+
+static void link(Grid *grid, int i, int cell){
+    grid->cell[i] = cell;
+    grid->prev[i] = -1;
+    grid->next[i] = grid->head[cell];
+    if (grid->head[cell] >= 0)
+        grid->prev[grid->head[cell]] = i;
+    grid->head[cell] = i;
+}
+
+void grid_clear(Grid *grid){
+    int c;
+    for (c = 0; c < GRID_CELLS; c++)
+        grid->head[c] = -1;
+}
+
+void grid_insert(Grid *grid, int i, int x, int y){
+    link(grid, i, row_of(y) * GRID_COLUMNS + column_of(x));
+}
+
+void grid_remove(Grid *grid, int i){
+    if (grid->prev[i] >= 0)
+        grid->next[grid->prev[i]] = grid->next[i];
+    else
+        grid->head[grid->cell[i]] = grid->next[i];
+    if (grid->next[i] >= 0)
+        grid->prev[grid->next[i]] = grid->prev[i];
+}
+
+void grid_move(Grid *grid, int i, int x, int y){
+    int cell = row_of(y) * GRID_COLUMNS + column_of(x);
+    if (cell == grid->cell[i])
+        return;
+    grid_remove(grid, i);
+    link(grid, i, cell);
+}
+
+int grid_cells(int x, int y, int r){
+    return (column_of(x + r) - column_of(x - r) + 1) * (row_of(y + r) - row_of(y - r) + 1);
+}
+
+int grid_query(Grid *grid, int x, int y, int r){
+    int left = column_of(x - r), right = column_of(x + r);
+    int top = row_of(y - r), bottom = row_of(y + r);
+    int row, column, i, count = 0;
+
+    for (row = top; row <= bottom; row++){
+        for (column = left; column <= right; column++){
+            for (i = grid->head[row * GRID_COLUMNS + column]; i >= 0; i = grid->next[i])
+                grid->found[count++] = i;
+        }
+    }
+    return count;
+}
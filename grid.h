@@ -0,0 +1,30 @@
+#ifndef DROPS_GRID_H
+#define DROPS_GRID_H
+
+// 16 pixel cells covering the 480x272 field. Whatever sits outside of it is
+// kept in the border cells.
+#define GRID_SHIFT 4
+#define GRID_COLUMNS 30
+#define GRID_ROWS 17
+#define GRID_CELLS (GRID_COLUMNS * GRID_ROWS)
+
+// Entities linked by cell. The per entity columns are allocated by the owner
+// of the grid, 'found' gets the result of the last query.
+typedef struct Grid {
+    int head[GRID_CELLS];
+    int *cell, *next, *prev;
+    int *found;
+} Grid;
+
+void grid_clear(Grid *grid);
+void grid_insert(Grid *grid, int i, int x, int y);
+void grid_remove(Grid *grid, int i);
+// Only relinks when the entity changed cell
+void grid_move(Grid *grid, int i, int x, int y);
+// How many cells a query would visit
+int grid_cells(int x, int y, int r);
+// Entities in every cell overlapping the square of half side r around (x, y),
+// stored in grid->found. Returns how many there are.
+int grid_query(Grid *grid, int x, int y, int r);
+
+#endif
@@ -0,0 +1,397 @@
+// Runs the game rules without display or audio, to measure how fast they go
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "game.h"
+#include "jobs.h"
+#include "replay.h"
+#include "rewind.h"
+#include "runner.h"
+#include "timing.h"
+
+typedef struct Scenario {
+    const char *name;
+    const char *description;
+    enum GameMode mode;
+    void (*setup)();
+    // Called before every tick to keep the scenario in its intended state
+    void (*prepare)(JoystickState *input);
+} Scenario;
+
+static Game game = { .parallel = 1 };
+// Scenario setups draw from their own stream, not from the game's
+static Rng scenario_rng;
+static uint64_t seed = 1;
+// Entity capacities, 0 for the scenario mode defaults
+static int drop_capacity, enemy_capacity;
+// Snapshot every tick into this history when its capacity is set
+static Rewind history;
+
+// Go for the nearest drop, and raise the force field when an enemy gets close
+static void bot_input(const Game *g, JoystickState *input, void *data){
+    int i, n, dx, dy, d, best = -1, best_d = 0;
+
+    memset(input, 0, sizeof(*input));
+    input->analog_x = input->analog_y = 128;
+
+    for (n = 0; n < g->drops.slots.active_count; n++){
+        i = g->drops.slots.active[n];
+        if (g->drops.state[i] == DROP_STATE_DYING)
+            continue;
+        dx = g->drops.x[i] - g->player.x;
+        dy = g->drops.y[i] - g->player.y;
+        d = dx * dx + dy * dy;
+        if (best < 0 || d < best_d){
+            best = i;
+            best_d = d;
+        }
+    }
+    if (best >= 0){
+        dx = g->drops.x[best] - g->player.x;
+        dy = g->drops.y[best] - g->player.y;
+        input->analog_x = dx < -2 ? 0 : dx > 2 ? 255 : 128;
+        input->analog_y = dy < -2 ? 0 : dy > 2 ? 255 : 128;
+    }
+
+    for (n = 0; n < g->enemies.slots.active_count; n++){
+        i = g->enemies.slots.active[n];
+        if (collide(g->player.x, g->player.y, g->player.size + 20, g->enemies.x[i], g->enemies.y[i], 2)){
+            input->buttons[PSP_BUTTON_CROSS] = 1;
+            break;
+        }
+    }
+}
+
+static void start_playing(){
+    if (reset_game(&game) < 0){
+        fprintf(stderr, "can't allocate the game entities\n");
+        exit(1);
+    }
+    game.state = GAME_STATE_PLAYING;
+    start_clock(&game);
+}
+
+static void start_at_max_level(){
+    start_playing();
+    game.level = 20;
+    game.player.points = 40 * 500 + 1;
+}
+
+// Away from the player, or a full arena is a hit on every slot at once
+#define FILL_CLEAR_RADIUS 60
+
+static void fill_enemies(){
+    int x, y;
+    while (game.enemies.slots.free_count){
+        x = rng_below(&scenario_rng, WIDTH);
+        y = rng_below(&scenario_rng, HEIGHT);
+        if (!collide(game.player.x, game.player.y, FILL_CLEAR_RADIUS, x, y, ENEMY_SIZE))
+            spawn_enemy(&game, x, y);
+    }
+}
+
+// Every hit kills an enemy, so a life per enemy outlasts any tick
+static void keep_enemy_cap(JoystickState *input){
+    fill_enemies();
+    game.player.life = game.enemies.slots.active_count + 5;
+}
+
+static void keep_berzerk(JoystickState *input){
+    keep_enemy_cap(input);
+    if (!game.player.berzerk)
+        game.player.energy = 1000;
+    input->buttons[PSP_BUTTON_TRIANGLE] = 1;
+}
+
+static void keep_bomb(JoystickState *input){
+    keep_enemy_cap(input);
+    if (game.player.bonus != BONUS_TYPE_BOMB){
+        game.player.bonus = BONUS_TYPE_BOMB;
+        game.player.bonus_start = get_clock(&game);
+        game.bonus.x = WIDTH / 2;
+        game.bonus.y = HEIGHT / 2;
+        game.bonus.grown_size = 10;
+    }
+}
+
+static void keep_alive(JoystickState *input){
+    game.player.life = 5;
+}
+
+static const Scenario scenarios[] = {
+    { "default", "a regular game from level 1", GAME_MODE_CLASSIC, start_playing, NULL },
+    { "max-level", "level 20 with a bonus popping every tick", GAME_MODE_CLASSIC, start_at_max_level, NULL },
+    { "enemy-cap", "all enemy slots busy, player never dies", GAME_MODE_CLASSIC, start_at_max_level, keep_enemy_cap },
+    { "berzerk", "berzerk triggered as often as possible", GAME_MODE_CLASSIC, start_at_max_level, keep_berzerk },
+    { "bomb", "bomb bonus always exploding", GAME_MODE_CLASSIC, start_at_max_level, keep_bomb },
+    { "swarm", "swarm mode from level 1, player never dies", GAME_MODE_SWARM, start_playing, keep_alive },
+    { "swarm-cap", "swarm mode with every enemy slot busy", GAME_MODE_SWARM, start_at_max_level, keep_enemy_cap },
+};
+
+#define SCENARIO_NUM ((int)(sizeof(scenarios) / sizeof(scenarios[0])))
+
+// Walk the whole history back, after a scenario snapshot every tick
+static void report_rewind(const Scenario *scenario, uint64_t in_push, uint64_t pushed){
+    int kept = rewind_available(&history), steps = 0;
+    uint64_t start = timing_now_ns(), elapsed;
+
+    while (rewind_back(&history, &game))
+        steps++;
+    elapsed = timing_now_ns() - start;
+    printf("%-10s %9.0f bytes/s of history %7.1f ns/snapshot %7.1f ns/step back   %.1f s kept\n",
+           "  rewind", history.snapshots ? (double)history.stored / history.snapshots * TICK_RATE : 0.0,
+           pushed ? (double)in_push / pushed : 0.0, steps ? (double)elapsed / steps : 0.0,
+           (double)kept / TICK_RATE);
+}
+
+static void run(const Scenario *scenario, long ticks){
+    JoystickState input;
+    uint64_t start, elapsed, before, in_update = 0, in_push = 0, in_setup = 0;
+    long i, restarts = 0;
+
+    seed_game(&game, seed);
+    rng_seed(&scenario_rng, seed, 1);
+    game.sim_ticks = 0;
+    configure_game(&game, scenario->mode, drop_capacity, enemy_capacity);
+    scenario->setup();
+    history.snapshots = history.stored = 0;
+    rewind_clear(&history);
+
+    start = timing_now_ns();
+    for (i = 0; i < ticks; i++){
+        game.sim_ticks = (Uint32)(i * 1000 / TICK_RATE);
+        bot_input(&game, &input, NULL);
+        if (scenario->prepare)
+            scenario->prepare(&input);
+        before = timing_now_ns();
+        update_game(&game, &input);
+        in_update += timing_now_ns() - before;
+        if (history.capacity){
+            before = timing_now_ns();
+            rewind_push(&history, &game);
+            in_push += timing_now_ns() - before;
+        }
+        // Starting over is not part of what gets measured
+        if (game.state == GAME_STATE_OVER){
+            before = timing_now_ns();
+            scenario->setup();
+            rewind_clear(&history);
+            in_setup += timing_now_ns() - before;
+            restarts++;
+        }
+    }
+    elapsed = timing_now_ns() - start - in_setup;
+
+    printf("%-10s %9ld ticks %12.0f ticks/s %9.1f ns/update   level %2d, %d points, %d enemies\n",
+           scenario->name, ticks,
+           elapsed ? ticks * 1e9 / elapsed : 0.0,
+           ticks ? (double)in_update / ticks : 0.0,
+           game.level, game.player.points, game.enemies.slots.active_count);
+    if (restarts)
+        printf("%-10s %ld games over, restarted\n", "", restarts);
+    // One update per displayed frame must fit in a 60 Hz frame
+    if (ticks && in_update / ticks > 1000000000 / 60)
+        printf("%-10s over the %d ns frame budget\n", scenario->name, 1000000000 / 60);
+    if (history.capacity)
+        report_rewind(scenario, in_push, ticks);
+}
+
+// The bot plays a regular game until it dies or 'ticks' ran out
+static int record(const char *path, long ticks){
+    Replay replay = { { 0 } };
+    ReplayTick tick;
+    long i;
+
+    seed_game(&game, seed);
+    configure_game(&game, GAME_MODE_CLASSIC, drop_capacity, enemy_capacity);
+    game.sim_ticks = game.sim_fraction = 0;
+    start_playing();
+    replay_begin(&replay, &game);
+    memset(&tick, 0, sizeof(tick));
+    tick.steps = 1;
+    for (i = 0; i < ticks && game.state == GAME_STATE_PLAYING; i++){
+        step_clock(&game);
+        bot_input(&game, &tick.input, NULL);
+        if (replay_record(&replay, &tick) < 0)
+            return 1;
+        update_game(&game, &tick.input);
+    }
+    if (replay_save(&replay, &game, path) < 0)
+        return 1;
+    printf("%s: %u ticks in %u bytes, level %d, %d points\n", path, replay.header.ticks, replay.size, game.level, game.player.points);
+    replay_free(&replay);
+    return 0;
+}
+
+// Replay as fast as possible, and check the game ends the same way
+static int play(const char *path){
+    Replay replay;
+    ReplayTick tick;
+    uint64_t start, elapsed, before, in_update = 0;
+    long ticks = 0;
+    int matches;
+
+    if (replay_load(&replay, path) < 0)
+        return 1;
+    game.sim_ticks = 0;
+    if (replay_start(&replay, &game) < 0)
+        return 1;
+
+    start = timing_now_ns();
+    while (replay_next(&replay, &tick)){
+        replay_advance(&tick, &game);
+        before = timing_now_ns();
+        update_game(&game, &tick.input);
+        in_update += timing_now_ns() - before;
+        ticks++;
+    }
+    elapsed = timing_now_ns() - start;
+
+    matches = replay_matches(&replay, &game);
+    printf("%-10s %9ld ticks %12.0f ticks/s %9.1f ns/update   level %2d, %d points, %s\n",
+           "replay", ticks,
+           elapsed ? ticks * 1e9 / elapsed : 0.0,
+           ticks ? (double)in_update / ticks : 0.0,
+           game.level, game.player.points, matches ? "as recorded" : "DIFFERENT FROM THE RECORDING");
+    replay_free(&replay);
+    return !matches;
+}
+
+// Many bot games at once, one per seed, to see how far the level curve lets
+// it go. Each game stops after 'ticks' if the bot is still alive.
+static int batch(int games, long ticks){
+    GameRun *runs = calloc(games, sizeof(GameRun));
+    int reached[21] = { 0 }, i, over = 0;
+    double points = 0, levels = 0;
+    long total = 0;
+    uint64_t start, elapsed;
+
+    if (runs == NULL)
+        return 1;
+    for (i = 0; i < games; i++){
+        runs[i].seed = seed + i;
+        runs[i].mode = GAME_MODE_CLASSIC;
+        runs[i].drop_capacity = drop_capacity;
+        runs[i].enemy_capacity = enemy_capacity;
+        runs[i].policy = bot_input;
+        runs[i].max_ticks = ticks;
+    }
+    start = timing_now_ns();
+    if (run_games(runs, games) < 0){
+        fprintf(stderr, "can't allocate the game entities\n");
+        free(runs);
+        return 1;
+    }
+    elapsed = timing_now_ns() - start;
+
+    for (i = 0; i < games; i++){
+        total += runs[i].ticks;
+        points += runs[i].points;
+        levels += runs[i].level;
+        over += runs[i].over;
+        reached[keep_inside(runs[i].level, 0, 20)]++;
+    }
+    printf("%-10s %9ld ticks %12.0f ticks/s   %d games, %d over, mean level %.2f, mean %.0f points\n",
+           "batch", total, elapsed ? total * 1e9 / elapsed : 0.0,
+           games, over, levels / games, points / games);
+    for (i = 1; i <= 20; i++){
+        if (reached[i])
+            printf("%-10s level %2d  %d games\n", "", i, reached[i]);
+    }
+    free(runs);
+    return 0;
+}
+
+static void usage(const char *name){
+    int i;
+    fprintf(stderr, "usage: %s [-n ticks] [-d drops] [-e enemies] [-k kernels] [-t threads] [-s seed] [-R seconds] [scenario...]\n"
+            "       %s [-n ticks] [-s seed] -w replay\n"
+            "       %s [-k kernels] [-t threads] -r replay\n"
+            "       %s [-n ticks] [-k kernels] [-t threads] [-s seed] -b games\n\nscenarios:\n", name, name, name, name);
+    for (i = 0; i < SCENARIO_NUM; i++)
+        fprintf(stderr, "  %-10s %s\n", scenarios[i].name, scenarios[i].description);
+    exit(1);
+}
+
+int main(int argc, char *argv[]){
+    long ticks = 100000;
+    int i, j, selected = 0, games = 0;
+    int run_scenario[SCENARIO_NUM] = { 0 };
+    const char *record_path = NULL, *replay_path = NULL;
+
+    batch_init();
+    for (i = 1; i < argc; i++){
+        if (!strcmp(argv[i], "-n") && i + 1 < argc){
+            ticks = atol(argv[++i]);
+            continue;
+        }
+        if (!strcmp(argv[i], "-d") && i + 1 < argc){
+            drop_capacity = atoi(argv[++i]);
+            continue;
+        }
+        if (!strcmp(argv[i], "-e") && i + 1 < argc){
+            enemy_capacity = atoi(argv[++i]);
+            continue;
+        }
+        if (!strcmp(argv[i], "-w") && i + 1 < argc){
+            record_path = argv[++i];
+            continue;
+        }
+        if (!strcmp(argv[i], "-r") && i + 1 < argc){
+            replay_path = argv[++i];
+            continue;
+        }
+        if (!strcmp(argv[i], "-R") && i + 1 < argc){
+            if (rewind_init(&history, atoi(argv[++i]) * TICK_RATE, REWIND_BUDGET) < 0)
+                usage(argv[0]);
+            continue;
+        }
+        if (!strcmp(argv[i], "-b") && i + 1 < argc){
+            games = atoi(argv[++i]);
+            continue;
+        }
+        if (!strcmp(argv[i], "-s") && i + 1 < argc){
+            seed = strtoull(argv[++i], NULL, 0);
+            continue;
+        }
+        if (!strcmp(argv[i], "-t") && i + 1 < argc){
+            jobs_start(atoi(argv[++i]));
+            continue;
+        }
+        if (!strcmp(argv[i], "-k") && i + 1 < argc){
+            if (batch_select(argv[++i]) < 0)
+                usage(argv[0]);
+            continue;
+        }
+        for (j = 0; j < SCENARIO_NUM; j++){
+            if (!strcmp(argv[i], scenarios[j].name))
+                break;
+        }
+        if (j == SCENARIO_NUM)
+            usage(argv[0]);
+        run_scenario[j] = 1;
+        selected = 1;
+    }
+
+    if (record_path)
+        return record(record_path, ticks);
+    printf("%s kernels, %d threads\n", batch_kernels(), jobs_threads());
+    if (replay_path){
+        i = play(replay_path);
+        jobs_stop();
+        return i;
+    }
+    if (games > 0){
+        i = batch(games, ticks);
+        jobs_stop();
+        return i;
+    }
+    for (j = 0; j < SCENARIO_NUM; j++){
+        if (!selected || run_scenario[j])
+            run(&scenarios[j], ticks);
+    }
+    jobs_stop();
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "input.h"
+#include "timing.h"
+
+// JoystickState slot of each SDL joystick button, -1 for the ones we ignore
+#ifdef _PSP_FW_VERSION
+static const int slots[INPUT_JOYSTICK_BUTTONS] = {
+    PSP_BUTTON_TRIANGLE, PSP_BUTTON_CIRCLE, PSP_BUTTON_CROSS, PSP_BUTTON_SQUARE,
+    PSP_BUTTON_L, PSP_BUTTON_R, PSP_BUTTON_DOWN, PSP_BUTTON_LEFT,
+    PSP_BUTTON_UP, PSP_BUTTON_RIGHT, PSP_BUTTON_SELECT, PSP_BUTTON_START
+};
+#else
+static const int slots[INPUT_JOYSTICK_BUTTONS] = {
+    PSP_BUTTON_TRIANGLE, PSP_BUTTON_CIRCLE, PSP_BUTTON_CROSS, PSP_BUTTON_SQUARE,
+    -1, -1, PSP_BUTTON_L, PSP_BUTTON_R,
+    PSP_BUTTON_SELECT, -1, -1, PSP_BUTTON_START
+};
+#endif
+
+void input_init(Input *input, SDL_Joystick *joystick){
+    memset(input, 0, sizeof(*input));
+    input->joystick = joystick;
+    input->state.analog_x = input->state.analog_y = 128;
+}
+
+static void add_event(Input *input, int button, int pressed, uint64_t time){
+    InputEvent *event;
+
+    if (button >= INPUT_JOYSTICK_BUTTONS || slots[button] < 0)
+        return;
+    if (pressed)
+        input->pressed[button] = 1;
+    if (input->unshown == 0)
+        input->unshown = time;
+    // Dropped events still latched their press
+    if (input->event_count == INPUT_MAX_EVENTS)
+        return;
+    event = &input->events[input->event_count++];
+    event->button = slots[button];
+    event->pressed = pressed;
+    event->time = time;
+}
+
+static void merge(Input *input){
+    JoystickState *state = &input->state;
+    int i;
+
+    memset(state->buttons, 0, sizeof(state->buttons));
+    for (i = 0; i < INPUT_JOYSTICK_BUTTONS; i++){
+        if (slots[i] >= 0 && (input->pressed[i] || SDL_JoystickGetButton(input->joystick, i)))
+            state->buttons[slots[i]] = 1;
+    }
+}
+
+void input_poll(Input *input){
+    SDL_Event event;
+    uint64_t now;
+
+    // Pumping the events updates the joystick too, no SDL_JoystickUpdate()
+    input->event_count = 0;
+    while (SDL_PollEvent(&event)){
+        now = timing_now_ns();
+        switch (event.type){
+        case SDL_QUIT:
+            input->quit = 1;
+            break;
+        case SDL_JOYBUTTONDOWN:
+            add_event(input, event.jbutton.button, 1, now);
+            break;
+        case SDL_JOYBUTTONUP:
+            add_event(input, event.jbutton.button, 0, now);
+            break;
+        }
+    }
+    merge(input);
+    input->state.analog_x = (SDL_JoystickGetAxis(input->joystick, 0) / 256) + 128;
+    input->state.analog_y = (SDL_JoystickGetAxis(input->joystick, 1) / 256) + 128;
+}
+
+void input_updated(Input *input){
+    memset(input->pressed, 0, sizeof(input->pressed));
+    merge(input);
+}
+
+uint64_t input_take_unshown(Input *input){
+    uint64_t time = input->unshown;
+    input->unshown = 0;
+    return time;
+}
+
+void input_presented(Input *input, uint64_t time){
+    InputLatency *latency = &input->latency;
+    uint64_t elapsed = timing_now_ns() - time, bucket = elapsed / 100000;
+
+    if (latency->count == 0 || elapsed < latency->min)
+        latency->min = elapsed;
+    if (elapsed > latency->max)
+        latency->max = elapsed;
+    latency->sum += elapsed;
+    latency->count++;
+    latency->histogram[bucket < INPUT_LATENCY_BUCKETS ? bucket : INPUT_LATENCY_BUCKETS - 1]++;
+}
+
+void input_print_latency(const Input *input){
+    const InputLatency *latency = &input->latency;
+    Uint32 seen = 0, i;
+
+    if (latency->count == 0){
+        printf("input latency: no events\n");
+        return;
+    }
+    for (i = 0; i < INPUT_LATENCY_BUCKETS - 1; i++){
+        seen += latency->histogram[i];
+        if (seen * 100ull >= latency->count * 99ull)
+            break;
+    }
+    printf("input latency: %u events, min %.1f ms, avg %.1f ms, p99 %.1f ms, max %.1f ms\n",
+           latency->count, latency->min / 1e6, latency->sum / latency->count / 1e6,
+           (i + 1) / 10.0, latency->max / 1e6);
+}
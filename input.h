@@ -0,0 +1,55 @@
+#ifndef DROPS_INPUT_H
+#define DROPS_INPUT_H
+
+#include <SDL.h>
+
+#include "game.h"
+
+#define INPUT_MAX_EVENTS 64
+// Joystick buttons SDL numbers that we know about
+#define INPUT_JOYSTICK_BUTTONS 12
+// 100 µs each, the last one holds anything slower
+#define INPUT_LATENCY_BUCKETS 1000
+
+typedef struct InputEvent {
+    // PSP_BUTTON_*
+    int button;
+    int pressed;
+    // When it got out of the SDL queue, from timing_now_ns()
+    uint64_t time;
+} InputEvent;
+
+// Time from input events to the first frame presented after them
+typedef struct InputLatency {
+    Uint32 count;
+    uint64_t sum, min, max;
+    Uint32 histogram[INPUT_LATENCY_BUCKETS];
+} InputLatency;
+
+typedef struct Input {
+    SDL_Joystick *joystick;
+    // What update_game() gets: the buttons held now, plus the ones pressed
+    // since the last update even if they were released already
+    JoystickState state;
+    // Presses and releases out of the last input_poll(), oldest first
+    InputEvent events[INPUT_MAX_EVENTS];
+    int event_count;
+    int quit;
+    int pressed[INPUT_JOYSTICK_BUTTONS];
+    // Oldest event no frame showed yet, 0 when there's none
+    uint64_t unshown;
+    InputLatency latency;
+} Input;
+
+void input_init(Input *input, SDL_Joystick *joystick);
+// Drain every pending event, then read the axes and held buttons
+void input_poll(Input *input);
+// update_game() saw the presses, only held buttons count from now on
+void input_updated(Input *input);
+// Time of the oldest event since the last call, 0 when there was none
+uint64_t input_take_unshown(Input *input);
+// A frame showing the events from 'time' on was just presented
+void input_presented(Input *input, uint64_t time);
+void input_print_latency(const Input *input);
+
+#endif
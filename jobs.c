@@ -0,0 +1,159 @@
+#include "jobs.h"
+
+#ifdef _PSP_FW_VERSION
+
+// Single core, everything runs in place
+int jobs_start(int threads){
+    return 1;
+}
+
+void jobs_stop(){
+}
+
+int jobs_threads(){
+    return 1;
+}
+
+void jobs_run(JobFunc fn, void *data, int count, int grain){
+    if (count > 0)
+        fn(data, 0, count);
+}
+
+#else
+
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+
+// Chunks queued for a worker, on their own cache line. The owner and the
+// thieves all take them from the front.
+typedef struct Queue {
+    int next, end;
+    char padding[64 - 2 * sizeof(int)];
+} Queue;
+
+typedef struct Job {
+    JobFunc fn;
+    void *data;
+    int count, grain;
+} Job;
+
+static Queue queues[JOBS_MAX_THREADS];
+static pthread_t helpers[JOBS_MAX_THREADS];
+static int thread_count = 1;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done = PTHREAD_COND_INITIALIZER;
+// All protected by the lock
+static Job job;
+static unsigned generation;
+static int busy, stopping;
+// Chunks of the current job not done yet
+static int pending;
+
+static void work(int self){
+    Queue *queue;
+    int k, chunk, begin, end;
+
+    for (k = 0; k < thread_count; k++){
+        queue = &queues[(self + k) % thread_count];
+        while ((chunk = __atomic_fetch_add(&queue->next, 1, __ATOMIC_ACQ_REL)) < queue->end){
+            begin = chunk * job.grain;
+            end = begin + job.grain < job.count ? begin + job.grain : job.count;
+            job.fn(job.data, begin, end);
+            __atomic_sub_fetch(&pending, 1, __ATOMIC_ACQ_REL);
+        }
+    }
+}
+
+static void *helper_main(void *arg){
+    int self = (int)(intptr_t)arg;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&lock);
+    while (1){
+        while (generation == seen && !stopping)
+            pthread_cond_wait(&wake, &lock);
+        if (stopping)
+            break;
+        seen = generation;
+        busy++;
+        pthread_mutex_unlock(&lock);
+
+        work(self);
+
+        pthread_mutex_lock(&lock);
+        if (--busy == 0)
+            pthread_cond_signal(&done);
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+int jobs_start(int threads){
+    int i;
+
+    jobs_stop();
+    if (threads > JOBS_MAX_THREADS)
+        threads = JOBS_MAX_THREADS;
+    for (i = 1; i < threads; i++){
+        if (pthread_create(&helpers[i], NULL, helper_main, (void *)(intptr_t)i) != 0)
+            break;
+        thread_count++;
+    }
+    return thread_count;
+}
+
+void jobs_stop(){
+    int i;
+
+    pthread_mutex_lock(&lock);
+    stopping = 1;
+    pthread_cond_broadcast(&wake);
+    pthread_mutex_unlock(&lock);
+    for (i = 1; i < thread_count; i++)
+        pthread_join(helpers[i], NULL);
+    thread_count = 1;
+    stopping = 0;
+}
+
+int jobs_threads(){
+    return thread_count;
+}
+
+void jobs_run(JobFunc fn, void *data, int count, int grain){
+    int i, chunks = (count + grain - 1) / grain;
+
+    if (count <= 0)
+        return;
+    if (thread_count == 1 || chunks < 2){
+        fn(data, 0, count);
+        return;
+    }
+
+    // Helpers still leaving the last job would see the new one half written
+    pthread_mutex_lock(&lock);
+    while (busy)
+        pthread_cond_wait(&done, &lock);
+    job.fn = fn;
+    job.data = data;
+    job.count = count;
+    job.grain = grain;
+    for (i = 0; i < thread_count; i++){
+        queues[i].next = chunks * i / thread_count;
+        queues[i].end = chunks * (i + 1) / thread_count;
+    }
+    pending = chunks;
+    generation++;
+    pthread_cond_broadcast(&wake);
+    pthread_mutex_unlock(&lock);
+
+    work(0);
+
+    // Chunks taken by helpers may still be running
+    while (__atomic_load_n(&pending, __ATOMIC_ACQUIRE))
+        sched_yield();
+}
+
+#endif
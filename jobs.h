@@ -0,0 +1,19 @@
+#ifndef DROPS_JOBS_H
+#define DROPS_JOBS_H
+
+#define JOBS_MAX_THREADS 32
+
+// Runs fn over [begin, end) pieces of a range
+typedef void (*JobFunc)(void *data, int begin, int end);
+
+// Start threads - 1 helper threads, the caller of jobs_run() being the last
+// one. Returns how many threads run jobs, 1 when there are no helpers.
+int jobs_start(int threads);
+void jobs_stop();
+int jobs_threads();
+// Split [0, count) in chunks of 'grain', spread them over the threads and
+// return once they are all done. Idle threads steal chunks from the others.
+// With a single chunk or no helpers, fn just runs here.
+void jobs_run(JobFunc fn, void *data, int count, int grain);
+
+#endif
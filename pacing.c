@@ -0,0 +1,139 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _PSP_FW_VERSION
+#include <sched.h>
+#endif
+
+#include "pacing.h"
+#include "timing.h"
+
+// Sleeps wake up this late at least, whatever they did so far
+#define MIN_MARGIN 200000
+
+static void sleep_ns(uint64_t ns){
+#ifdef _PSP_FW_VERSION
+    sceKernelDelayThread(ns / 1000);
+#else
+    struct timespec ts = { ns / 1000000000, ns % 1000000000 };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+// Let the other threads run while spinning
+static void yield(){
+#ifdef _PSP_FW_VERSION
+    sceKernelDelayThread(0);
+#else
+    sched_yield();
+#endif
+}
+
+void pacing_init(Pacing *pacing, int fps){
+    memset(pacing, 0, sizeof(*pacing));
+    pacing->interval = fps > 0 ? 1000000000ull / fps : 0;
+    pacing->margin = 2000000;
+}
+
+static void record(Pacing *pacing, uint64_t now){
+    uint64_t elapsed = now - pacing->last, bucket = elapsed / PACING_BUCKET_NS;
+
+    if (pacing->last){
+        if (pacing->count == 0 || elapsed < pacing->min)
+            pacing->min = elapsed;
+        if (elapsed > pacing->max)
+            pacing->max = elapsed;
+        pacing->sum += elapsed;
+        pacing->sum_squares += (double)elapsed * elapsed;
+        pacing->count++;
+        pacing->histogram[bucket < PACING_BUCKETS ? bucket : PACING_BUCKETS - 1]++;
+    }
+    pacing->last = now;
+}
+
+void pacing_wait(Pacing *pacing){
+    uint64_t now = timing_now_ns(), wanted, late;
+
+    if (pacing->interval == 0){
+        record(pacing, now);
+        return;
+    }
+    if (pacing->deadline == 0)
+        pacing->deadline = now + pacing->interval;
+
+    // Sleep most of the way, then spin to the deadline
+    if (pacing->deadline > now + pacing->margin){
+        wanted = pacing->deadline - pacing->margin - now;
+        sleep_ns(wanted);
+        late = timing_now_ns() - now;
+        late = late > wanted ? late - wanted : 0;
+        if (late > pacing->margin)
+            pacing->margin = late;
+        else
+            pacing->margin -= (pacing->margin - late) / 64;
+        if (pacing->margin < MIN_MARGIN)
+            pacing->margin = MIN_MARGIN;
+    }
+    while ((now = timing_now_ns()) < pacing->deadline)
+        yield();
+
+    // A late frame makes the next wait shorter, so the frames keep to the
+    // same schedule. One that missed it by a whole frame starts a new one.
+    if (now - pacing->deadline > pacing->interval){
+        pacing->missed++;
+        pacing->deadline = now;
+    }
+    pacing->deadline += pacing->interval;
+    record(pacing, now);
+}
+
+void pacing_mark(Pacing *pacing){
+    uint64_t now = timing_now_ns();
+    pacing->deadline = now + pacing->interval;
+    record(pacing, now);
+}
+
+static double percentile(const Pacing *pacing, int percent){
+    uint64_t seen = 0;
+    int i;
+    for (i = 0; i < PACING_BUCKETS - 1; i++){
+        seen += pacing->histogram[i];
+        if (seen * 100 >= (uint64_t)pacing->count * percent)
+            break;
+    }
+    return (i + 1) * PACING_BUCKET_NS / 1e6;
+}
+
+void pacing_print(const Pacing *pacing){
+    double mean, deviation;
+    uint32_t row, most = 0;
+    int i, j;
+
+    if (pacing->count == 0)
+        return;
+    mean = (double)pacing->sum / pacing->count;
+    deviation = sqrt(fmax(pacing->sum_squares / pacing->count - mean * mean, 0));
+    if (pacing->interval)
+        printf("frame pacing: %.0f fps target", 1e9 / pacing->interval);
+    else
+        printf("frame pacing: unlocked");
+    printf(", %u frames, mean %.2f ms, std dev %.2f ms, p50 %.1f ms, p99 %.1f ms, min %.2f ms, max %.2f ms, %u missed\n",
+           pacing->count, mean / 1e6, deviation / 1e6, percentile(pacing, 50), percentile(pacing, 99),
+           pacing->min / 1e6, pacing->max / 1e6, pacing->missed);
+
+    // Rows of 0.5 ms, the empty ones left out
+    for (i = 0; i < PACING_BUCKETS; i += 5){
+        for (row = 0, j = i; j < i + 5; j++)
+            row += pacing->histogram[j];
+        if (row > most)
+            most = row;
+    }
+    for (i = 0; i < PACING_BUCKETS; i += 5){
+        for (row = 0, j = i; j < i + 5; j++)
+            row += pacing->histogram[j];
+        if (row)
+            printf("  %5.1f ms %-40.*s %u\n", i * PACING_BUCKET_NS / 1e6, (int)((row * 40ull + most - 1) / most),
+                   "########################################", row);
+    }
+}
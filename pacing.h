@@ -0,0 +1,33 @@
+#ifndef DROPS_PACING_H
+#define DROPS_PACING_H
+
+#include <stdint.h>
+
+// Frame intervals by 0.1 ms, the last bucket holds anything slower
+#define PACING_BUCKET_NS 100000
+#define PACING_BUCKETS 500
+
+typedef struct Pacing {
+    // Nanoseconds per frame, 0 to run unlocked
+    uint64_t interval;
+    uint64_t deadline;
+    // When the last frame was let go, 0 before the first one
+    uint64_t last;
+    // Sleeping stops this long before the deadline and we spin from there.
+    // Follows how late the sleeps wake up.
+    uint64_t margin;
+    uint32_t count, missed;
+    uint64_t sum, min, max;
+    double sum_squares;
+    uint32_t histogram[PACING_BUCKETS];
+} Pacing;
+
+// 0 fps for unlocked
+void pacing_init(Pacing *pacing, int fps);
+// Once per frame: wait for its deadline, then count the interval
+void pacing_wait(Pacing *pacing);
+// Once per frame paced by something else, vsync for instance
+void pacing_mark(Pacing *pacing);
+void pacing_print(const Pacing *pacing);
+
+#endif
@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _PSP_FW_VERSION
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "pack.h"
+
+#ifdef _PSP_FW_VERSION
+// No mmap here, read it all in one go
+static Uint8 *map_file(const char *path, size_t *size){
+    FILE *file = fopen(path, "rb");
+    Uint8 *data = NULL;
+    long length;
+
+    if (file == NULL)
+        return NULL;
+    if (fseek(file, 0, SEEK_END) == 0 && (length = ftell(file)) > 0){
+        rewind(file);
+        data = malloc(length);
+        if (data && fread(data, 1, length, file) != (size_t)length){
+            free(data);
+            data = NULL;
+        }
+        *size = length;
+    }
+    fclose(file);
+    return data;
+}
+#else
+static Uint8 *map_file(const char *path, size_t *size){
+    struct stat st;
+    void *data;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) < 0 || st.st_size == 0){
+        close(fd);
+        return NULL;
+    }
+    // Private and writable so that SDL can't fault on it, nothing is written back
+    data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return NULL;
+    *size = st.st_size;
+    return data;
+}
+#endif
+
+int pack_open(Pack *pack, const char *path){
+    const PackHeader *header;
+    int i;
+
+    memset(pack, 0, sizeof(*pack));
+    pack->data = map_file(path, &pack->size);
+    if (pack->data == NULL)
+        return -1;
+
+    header = (const PackHeader *)pack->data;
+    if (pack->size < sizeof(PackHeader) || header->magic != PACK_MAGIC || header->version != PACK_VERSION
+        || pack->size < sizeof(PackHeader) + header->count * sizeof(PackEntry))
+        goto invalid;
+    pack->entries = (const PackEntry *)(header + 1);
+    pack->count = header->count;
+    for (i = 0; i < pack->count; i++){
+        if (pack->entries[i].offset > pack->size || pack->entries[i].size > pack->size - pack->entries[i].offset)
+            goto invalid;
+    }
+    return 0;
+
+invalid:
+    fprintf(stderr, "%s: invalid asset pack, ignored\n", path);
+#ifdef _PSP_FW_VERSION
+    free(pack->data);
+#else
+    munmap(pack->data, pack->size);
+#endif
+    memset(pack, 0, sizeof(*pack));
+    return -1;
+}
+
+const PackEntry *pack_find(const Pack *pack, const char *name){
+    int i;
+    for (i = 0; i < pack->count; i++){
+        if (!strncmp(pack->entries[i].name, name, PACK_NAME_MAX))
+            return &pack->entries[i];
+    }
+    return NULL;
+}
+
+SDL_Surface *pack_surface(const Pack *pack, const char *name, const SDL_PixelFormat *format){
+    const PackEntry *entry = pack_find(pack, name);
+    SDL_Surface *surface, *converted;
+
+    if (entry == NULL || entry->type != PACK_ENTRY_IMAGE || entry->size < entry->pitch * entry->h)
+        return NULL;
+    surface = SDL_CreateRGBSurfaceFrom(pack->data + entry->offset, entry->w, entry->h, 32, entry->pitch,
+                                       entry->rmask, entry->gmask, entry->bmask, entry->amask);
+    if (surface == NULL)
+        return NULL;
+    if (format->BytesPerPixel == 4 && format->Rmask == entry->rmask
+        && format->Gmask == entry->gmask && format->Bmask == entry->bmask)
+        return surface;
+
+    // Packed for another screen, pay the conversion once
+    converted = entry->amask ? SDL_DisplayFormatAlpha(surface) : SDL_DisplayFormat(surface);
+    SDL_FreeSurface(surface);
+    return converted;
+}
+
+SDL_RWops *pack_rw(const Pack *pack, const char *name){
+    const PackEntry *entry = pack_find(pack, name);
+    if (entry == NULL || entry->type != PACK_ENTRY_BLOB)
+        return NULL;
+    return SDL_RWFromConstMem(pack->data + entry->offset, entry->size);
+}
@@ -0,0 +1,51 @@
+#ifndef DROPS_PACK_H
+#define DROPS_PACK_H
+
+#include <SDL.h>
+
+// Asset pack written by drops-pack: a header, a table of contents, then
+// each asset aligned on PACK_ALIGN bytes. Images are stored as raw pixels
+// already in the screen format, so they can be used in place.
+#define PACK_MAGIC 0x4b415044
+#define PACK_VERSION 1
+#define PACK_ALIGN 16
+#define PACK_NAME_MAX 24
+
+#define PACK_PATH "media/drops.pak"
+
+enum PackEntryType {
+    PACK_ENTRY_IMAGE,
+    PACK_ENTRY_BLOB
+};
+
+typedef struct PackHeader {
+    Uint32 magic;
+    Uint32 version;
+    Uint32 count;
+    Uint32 reserved;
+} PackHeader;
+
+typedef struct PackEntry {
+    char name[PACK_NAME_MAX];
+    Uint32 type;
+    // Bytes from the start of the pack
+    Uint32 offset, size;
+    // Images only
+    Uint32 w, h, pitch;
+    Uint32 rmask, gmask, bmask, amask;
+} PackEntry;
+
+typedef struct Pack {
+    Uint8 *data;
+    size_t size;
+    const PackEntry *entries;
+    int count;
+} Pack;
+
+int pack_open(Pack *pack, const char *path);
+const PackEntry *pack_find(const Pack *pack, const char *name);
+// Wraps the pixels in place when they match 'format', converts them otherwise
+SDL_Surface *pack_surface(const Pack *pack, const char *name, const SDL_PixelFormat *format);
+SDL_RWops *pack_rw(const Pack *pack, const char *name);
+
+#endif
@@ -0,0 +1,177 @@
+// Offline asset packer: decodes the media once and stores it ready to use
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+#include <SDL_image.h>
+
+#include "pack.h"
+
+typedef struct Asset {
+    const char *name;
+    const char *path;
+    enum PackEntryType type;
+} Asset;
+
+static const Asset assets[] = {
+    { "bg", "media/bg.png", PACK_ENTRY_IMAGE },
+    { "happy", "media/happy.png", PACK_ENTRY_IMAGE },
+    { "paused", "media/paused.png", PACK_ENTRY_IMAGE },
+    { "gameover", "media/gameover.png", PACK_ENTRY_IMAGE },
+    { "font", "media/DroidSans.ttf", PACK_ENTRY_BLOB },
+};
+
+#define ASSET_NUM ((int)(sizeof(assets) / sizeof(assets[0])))
+
+// 32 bit screen layouts: X11 and most desktops, then the PSP
+typedef struct Format {
+    const char *name;
+    Uint32 rmask, gmask, bmask, amask;
+} Format;
+
+static const Format formats[] = {
+    { "argb8888", 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000 },
+    { "abgr8888", 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000 },
+};
+
+#define FORMAT_NUM ((int)(sizeof(formats) / sizeof(formats[0])))
+
+static void *read_file(const char *path, Uint32 *size){
+    FILE *file = fopen(path, "rb");
+    void *data = NULL;
+    long length;
+
+    if (file == NULL)
+        return NULL;
+    if (fseek(file, 0, SEEK_END) == 0 && (length = ftell(file)) > 0){
+        rewind(file);
+        data = malloc(length);
+        if (data && fread(data, 1, length, file) != (size_t)length){
+            free(data);
+            data = NULL;
+        }
+        *size = length;
+    }
+    fclose(file);
+    return data;
+}
+
+// Convert to the target layout, keeping an alpha channel only where needed
+static void *convert_image(const char *path, const Format *format, PackEntry *entry){
+    SDL_Surface *image, *converted;
+    void *pixels;
+    int has_alpha, y;
+
+    image = IMG_Load(path);
+    if (image == NULL)
+        return NULL;
+    has_alpha = image->format->Amask || (image->flags & SDL_SRCCOLORKEY);
+
+    converted = SDL_CreateRGBSurface(SDL_SWSURFACE, image->w, image->h, 32, format->rmask,
+                                     format->gmask, format->bmask, has_alpha ? format->amask : 0);
+    if (converted == NULL){
+        SDL_FreeSurface(image);
+        return NULL;
+    }
+    // Copy alpha as is instead of blending it
+    SDL_SetAlpha(image, 0, 0);
+    SDL_FillRect(converted, NULL, 0);
+    SDL_BlitSurface(image, NULL, converted, NULL);
+
+    entry->w = converted->w;
+    entry->h = converted->h;
+    entry->pitch = converted->w * 4;
+    entry->rmask = format->rmask;
+    entry->gmask = format->gmask;
+    entry->bmask = format->bmask;
+    entry->amask = has_alpha ? format->amask : 0;
+    entry->size = entry->pitch * entry->h;
+
+    pixels = malloc(entry->size);
+    if (pixels){
+        for (y = 0; y < converted->h; y++)
+            memcpy((Uint8 *)pixels + y * entry->pitch, (Uint8 *)converted->pixels + y * converted->pitch, entry->pitch);
+    }
+    SDL_FreeSurface(converted);
+    SDL_FreeSurface(image);
+    return pixels;
+}
+
+static void usage(const char *name){
+    int i;
+    fprintf(stderr, "usage: %s [-f format] [output]\n\nformats:", name);
+    for (i = 0; i < FORMAT_NUM; i++)
+        fprintf(stderr, " %s", formats[i].name);
+    fprintf(stderr, "\n\nthe default output is %s\n", PACK_PATH);
+    exit(1);
+}
+
+int main(int argc, char *argv[]){
+    static const Uint8 padding[PACK_ALIGN];
+    const Format *format = &formats[0];
+    const char *output = PACK_PATH;
+    PackHeader header;
+    PackEntry entries[ASSET_NUM];
+    void *data[ASSET_NUM];
+    Uint32 offset;
+    FILE *file;
+    int i, j;
+
+    for (i = 1; i < argc; i++){
+        if (!strcmp(argv[i], "-f") && i + 1 < argc){
+            for (j = 0; j < FORMAT_NUM && strcmp(argv[i + 1], formats[j].name); j++);
+            if (j == FORMAT_NUM)
+                usage(argv[0]);
+            format = &formats[j];
+            i++;
+        }
+        else if (argv[i][0] == '-'){
+            usage(argv[0]);
+        }
+        else {
+            output = argv[i];
+        }
+    }
+
+    memset(entries, 0, sizeof(entries));
+    offset = sizeof(PackHeader) + sizeof(entries);
+    for (i = 0; i < ASSET_NUM; i++){
+        strncpy(entries[i].name, assets[i].name, PACK_NAME_MAX - 1);
+        entries[i].type = assets[i].type;
+        if (assets[i].type == PACK_ENTRY_IMAGE)
+            data[i] = convert_image(assets[i].path, format, &entries[i]);
+        else
+            data[i] = read_file(assets[i].path, &entries[i].size);
+        if (data[i] == NULL){
+            fprintf(stderr, "%s: can't load %s\n", argv[0], assets[i].path);
+            return 1;
+        }
+        offset = (offset + PACK_ALIGN - 1) & ~(PACK_ALIGN - 1);
+        entries[i].offset = offset;
+        offset += entries[i].size;
+    }
+
+    file = fopen(output, "wb");
+    if (file == NULL){
+        perror(output);
+        return 1;
+    }
+    header.magic = PACK_MAGIC;
+    header.version = PACK_VERSION;
+    header.count = ASSET_NUM;
+    header.reserved = 0;
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(entries, sizeof(entries), 1, file);
+    for (i = 0; i < ASSET_NUM; i++){
+        fwrite(padding, 1, entries[i].offset - ftell(file), file);
+        fwrite(data[i], 1, entries[i].size, file);
+        free(data[i]);
+    }
+    if (fclose(file) != 0){
+        perror(output);
+        return 1;
+    }
+    printf("%s: %d assets, %u bytes, %s\n", output, ASSET_NUM, offset, format->name);
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "prof.h"
+
+// A minute of frames, must be a power of two
+#define PROF_RING_SIZE 32768
+#define PROF_WINDOW_NS 1000000000ull
+
+typedef struct ProfEvent {
+    uint64_t start;
+    Uint32 duration;
+    Uint32 phase;
+    Uint32 thread;
+    // Index + 1 of the event in the slot, 0 while it gets written
+    Uint32 sequence;
+} ProfEvent;
+
+const char *prof_names[PROF_PHASE_NUM] = {
+    "input", "update", "background", "circles", "text", "fx", "flip", "frame", "latency"
+};
+
+static ProfEvent ring[PROF_RING_SIZE];
+static Uint32 head;
+// Where readers copy the ring, only one of them runs at a time
+static ProfEvent copy[PROF_RING_SIZE];
+static Uint32 durations[PROF_RING_SIZE];
+
+void prof_end(int phase, uint64_t start){
+    uint64_t now = timing_now_ns();
+    Uint32 n = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+    ProfEvent *event = &ring[n & (PROF_RING_SIZE - 1)];
+
+    // Readers skip slots whose sequence changed while they copied them
+    __atomic_store_n(&event->sequence, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    event->start = start;
+    event->duration = now - start;
+    event->phase = phase;
+    event->thread = SDL_ThreadID();
+    __atomic_store_n(&event->sequence, n + 1, __ATOMIC_RELEASE);
+}
+
+static int compare_starts(const void *a, const void *b){
+    uint64_t x = ((const ProfEvent *)a)->start, y = ((const ProfEvent *)b)->start;
+    return x < y ? -1 : x > y;
+}
+
+// Copy out the events of the last 'window' nanoseconds, oldest first
+static int collect(ProfEvent *out, uint64_t window){
+    Uint32 end = __atomic_load_n(&head, __ATOMIC_ACQUIRE), n;
+    uint64_t since = timing_now_ns() - window;
+    int count = 0;
+
+    n = end > PROF_RING_SIZE ? end - PROF_RING_SIZE : 0;
+    for (; n != end; n++){
+        ProfEvent *event = &ring[n & (PROF_RING_SIZE - 1)];
+        if (__atomic_load_n(&event->sequence, __ATOMIC_ACQUIRE) != n + 1)
+            continue;
+        out[count] = *event;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&event->sequence, __ATOMIC_RELAXED) != n + 1)
+            continue;
+        if (window == 0 || out[count].start >= since)
+            count++;
+    }
+    // Events are numbered when they end, put them back in start order
+    qsort(out, count, sizeof(ProfEvent), compare_starts);
+    return count;
+}
+
+static int compare_durations(const void *a, const void *b){
+    Uint32 x = *(const Uint32 *)a, y = *(const Uint32 *)b;
+    return x < y ? -1 : x > y;
+}
+
+void prof_stats(ProfStats stats[PROF_PHASE_NUM]){
+    int count = collect(copy, PROF_WINDOW_NS), i, p, n;
+    uint64_t sum;
+
+    for (p = 0; p < PROF_PHASE_NUM; p++){
+        sum = 0;
+        for (i = n = 0; i < count; i++){
+            if (copy[i].phase == p){
+                durations[n++] = copy[i].duration;
+                sum += copy[i].duration;
+            }
+        }
+        stats[p].count = n;
+        if (n == 0){
+            stats[p].min = stats[p].avg = stats[p].p99 = stats[p].max = 0;
+            continue;
+        }
+        qsort(durations, n, sizeof(Uint32), compare_durations);
+        stats[p].min = durations[0];
+        stats[p].avg = sum / n;
+        stats[p].p99 = durations[(n - 1) * 99 / 100];
+        stats[p].max = durations[n - 1];
+    }
+}
+
+int prof_write_trace(const char *path){
+    int count = collect(copy, 0), i;
+    uint64_t origin = count ? copy[0].start : 0;
+    FILE *file = fopen(path, "w");
+
+    if (file == NULL)
+        return -1;
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (i = 0; i < count; i++){
+        fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+                prof_names[copy[i].phase], copy[i].thread,
+                (copy[i].start - origin) / 1000.0, copy[i].duration / 1000.0,
+                i + 1 < count ? "," : "");
+    }
+    fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+    return fclose(file);
+}
@@ -0,0 +1,42 @@
+#ifndef DROPS_PROF_H
+#define DROPS_PROF_H
+
+#include <SDL.h>
+
+#include "timing.h"
+
+enum ProfPhase {
+    PROF_INPUT,
+    PROF_UPDATE,
+    PROF_BACKGROUND,
+    PROF_CIRCLES,
+    PROF_TEXT,
+    PROF_FX,
+    PROF_FLIP,
+    // Everything a frame took to draw and present
+    PROF_FRAME,
+    // From an input event to the frame showing it presented
+    PROF_LATENCY,
+    PROF_PHASE_NUM
+};
+
+// Timings of one phase over the last second, in nanoseconds
+typedef struct ProfStats {
+    int count;
+    Uint32 min, avg, p99, max;
+} ProfStats;
+
+extern const char *prof_names[PROF_PHASE_NUM];
+
+// Time a phase: t = prof_begin(); ...; prof_end(PROF_x, t). Any thread can
+// record, the events go to a ring that keeps the latest ones.
+static inline uint64_t prof_begin(){
+    return timing_now_ns();
+}
+
+void prof_end(int phase, uint64_t start);
+void prof_stats(ProfStats stats[PROF_PHASE_NUM]);
+// Chrome / Perfetto trace of the events still in the ring
+int prof_write_trace(const char *path);
+
+#endif
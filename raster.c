@@ -0,0 +1,60 @@
+#include <math.h>
+
+#include "fx.h"
+#include "raster.h"
+
+// Blend one pixel of the anti-aliased rim
+static void blend_pixel(Uint32 *pixel, const SDL_PixelFormat *format, Uint32 rgba, float coverage){
+    ColorOp op;
+    Uint32 alpha = rgba & 0xff;
+
+    if (coverage > 1)
+        coverage = 1;
+    color_op_tint(&op, format, (rgba & 0xffffff00) | (Uint32)(alpha * coverage + 0.5f));
+    color_op_row(pixel, 1, &op);
+}
+
+int raster_circle(SDL_Surface *surface, int x, int y, int r, Uint32 rgba){
+    const SDL_Rect *clip = &surface->clip_rect;
+    float inner = (r - 0.5f) * (r - 0.5f), coverage;
+    int top, bottom, left, right, j, dx, dy2, span;
+    ColorOp solid;
+    Uint32 *row;
+
+    if (surface->format->BytesPerPixel != 4)
+        return -1;
+    top = y - r > clip->y ? y - r : clip->y;
+    bottom = y + r < clip->y + clip->h - 1 ? y + r : clip->y + clip->h - 1;
+    if (top > bottom || r < 1)
+        return 0;
+    if (SDL_MUSTLOCK(surface) && SDL_LockSurface(surface) < 0)
+        return 0;
+
+    color_op_tint(&solid, surface->format, rgba);
+    for (j = top; j <= bottom; j++){
+        row = (Uint32 *)((Uint8 *)surface->pixels + j * surface->pitch);
+        dy2 = (j - y) * (j - y);
+
+        // Pixels up to 'span' away from the center are fully covered
+        span = dy2 <= inner ? (int)sqrtf(inner - dy2) : -1;
+        left = x - span > clip->x ? x - span : clip->x;
+        right = x + span < clip->x + clip->w - 1 ? x + span : clip->x + clip->w - 1;
+        if (left <= right)
+            color_op_row(row + left, right - left + 1, &solid);
+
+        // Then the rim fades out on both sides
+        for (dx = span + 1; ; dx++){
+            coverage = r + 0.5f - sqrtf((float)dx * dx + dy2);
+            if (coverage <= 0)
+                break;
+            if (x + dx >= clip->x && x + dx < clip->x + clip->w)
+                blend_pixel(row + x + dx, surface->format, rgba, coverage);
+            if (dx && x - dx >= clip->x && x - dx < clip->x + clip->w)
+                blend_pixel(row + x - dx, surface->format, rgba, coverage);
+        }
+    }
+
+    if (SDL_MUSTLOCK(surface))
+        SDL_UnlockSurface(surface);
+    return 0;
+}
@@ -0,0 +1,11 @@
+#ifndef DROPS_RASTER_H
+#define DROPS_RASTER_H
+
+#include <SDL.h>
+
+// Anti-aliased filled circle blended straight into a 32 bit surface, one span
+// per scanline, clipped to the surface clip rect. Same coverage rule as the
+// circle sprites. -1 when the surface isn't 32 bit.
+int raster_circle(SDL_Surface *surface, int x, int y, int r, Uint32 rgba);
+
+#endif
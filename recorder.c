@@ -0,0 +1,204 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "delta.h"
+#include "recorder.h"
+#include "timing.h"
+
+static int clamp_byte(int v){
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+// Full range BT.601, chroma averaged over each 2x2 block
+static void to_planes(Recorder *recorder, const Uint32 *pixels){
+    int w = recorder->w, h = recorder->h, i, j, k, r, g, b;
+    Uint8 *y = recorder->planes, *u = y + w * h, *v = u + (w / 2) * (h / 2);
+    Uint32 p[4];
+
+    for (i = 0; i < w * h; i++){
+        r = pixels[i] >> recorder->rshift & 0xff;
+        g = pixels[i] >> recorder->gshift & 0xff;
+        b = pixels[i] >> recorder->bshift & 0xff;
+        y[i] = (77 * r + 150 * g + 29 * b + 128) >> 8;
+    }
+    for (j = 0; j < h / 2; j++){
+        for (i = 0; i < w / 2; i++){
+            p[0] = pixels[2 * j * w + 2 * i];
+            p[1] = pixels[2 * j * w + 2 * i + 1];
+            p[2] = pixels[(2 * j + 1) * w + 2 * i];
+            p[3] = pixels[(2 * j + 1) * w + 2 * i + 1];
+            for (k = r = g = b = 0; k < 4; k++){
+                r += p[k] >> recorder->rshift & 0xff;
+                g += p[k] >> recorder->gshift & 0xff;
+                b += p[k] >> recorder->bshift & 0xff;
+            }
+            *u++ = clamp_byte(((-43 * r - 85 * g + 128 * b) / 4 + 32768 + 128) >> 8);
+            *v++ = clamp_byte(((128 * r - 107 * g - 21 * b) / 4 + 32768 + 128) >> 8);
+        }
+    }
+}
+
+static void write_y4m(Recorder *recorder, const RecorderSlot *slot){
+    size_t size = recorder->w * recorder->h + 2 * (recorder->w / 2) * (recorder->h / 2);
+    Uint32 n;
+
+    // Dropped frames show the last one again, the rate stays constant
+    if (recorder->next_number > 0){
+        for (n = recorder->next_number; n < slot->number; n++){
+            if (fputs("FRAME\n", recorder->file) < 0 || fwrite(recorder->planes, size, 1, recorder->file) != 1)
+                recorder->write_error = 1;
+        }
+    }
+    to_planes(recorder, slot->pixels);
+    if (fputs("FRAME\n", recorder->file) < 0 || fwrite(recorder->planes, size, 1, recorder->file) != 1)
+        recorder->write_error = 1;
+}
+
+static void write_delta(Recorder *recorder, const RecorderSlot *slot){
+    size_t words = recorder->w * recorder->h, i;
+    RecorderFrame frame;
+
+    for (i = 0; i < words; i++)
+        recorder->previous[i] ^= slot->pixels[i];
+    frame.number = slot->number;
+    frame.size = delta_encode(recorder->scratch, recorder->previous, words);
+    frame.time = slot->time;
+    memcpy(recorder->previous, slot->pixels, words * 4);
+    if (fwrite(&frame, sizeof(frame), 1, recorder->file) != 1
+        || (frame.size && fwrite(recorder->scratch, frame.size, 1, recorder->file) != 1))
+        recorder->write_error = 1;
+}
+
+// One post per captured frame, and one more to stop once they are all written
+static int writer_main(void *data){
+    Recorder *recorder = data;
+    RecorderSlot *slot;
+    Uint32 tail;
+
+    for (;;){
+        SDL_SemWait(recorder->posted);
+        tail = recorder->tail;
+        if (tail == __atomic_load_n(&recorder->head, __ATOMIC_ACQUIRE)){
+            if (__atomic_load_n(&recorder->stopping, __ATOMIC_ACQUIRE))
+                break;
+            continue;
+        }
+        slot = &recorder->slots[tail & (RECORDER_FRAMES - 1)];
+        if (!recorder->write_error){
+            if (recorder->y4m)
+                write_y4m(recorder, slot);
+            else
+                write_delta(recorder, slot);
+        }
+        recorder->next_number = slot->number + 1;
+        __atomic_store_n(&recorder->tail, tail + 1, __ATOMIC_RELEASE);
+    }
+    return 0;
+}
+
+int recorder_open(Recorder *recorder, const char *path, int w, int h, const SDL_PixelFormat *format, int fps){
+    size_t length = strlen(path), words = w * h;
+    RecorderHeader header;
+    int i;
+
+    memset(recorder, 0, sizeof(*recorder));
+    if (format->BytesPerPixel != 4)
+        return -1;
+    recorder->y4m = length > 4 && !strcmp(path + length - 4, ".y4m");
+    recorder->w = w;
+    recorder->h = h;
+    recorder->rshift = format->Rshift;
+    recorder->gshift = format->Gshift;
+    recorder->bshift = format->Bshift;
+    for (i = 0; i < RECORDER_FRAMES; i++){
+        if ((recorder->slots[i].pixels = malloc(words * 4)) == NULL)
+            goto fail;
+    }
+    if (recorder->y4m)
+        recorder->planes = malloc(words + 2 * (w / 2) * (h / 2));
+    else {
+        recorder->previous = calloc(words, 4);
+        recorder->scratch = malloc(DELTA_BOUND(words));
+    }
+    if (recorder->y4m ? recorder->planes == NULL : recorder->previous == NULL || recorder->scratch == NULL)
+        goto fail;
+    if ((recorder->file = fopen(path, "wb")) == NULL)
+        goto fail;
+
+    if (recorder->y4m)
+        fprintf(recorder->file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", w, h, fps > 0 ? fps : 60);
+    else {
+        header.magic = RECORDER_MAGIC;
+        header.version = RECORDER_VERSION;
+        header.w = w;
+        header.h = h;
+        header.rmask = format->Rmask;
+        header.gmask = format->Gmask;
+        header.bmask = format->Bmask;
+        header.fps = fps;
+        fwrite(&header, sizeof(header), 1, recorder->file);
+    }
+    recorder->posted = SDL_CreateSemaphore(0);
+    if (recorder->posted == NULL || (recorder->writer = SDL_CreateThread(writer_main, recorder)) == NULL)
+        goto fail;
+    return 0;
+
+fail:
+    recorder_close(recorder);
+    return -1;
+}
+
+void recorder_capture(Recorder *recorder, SDL_Surface *surface){
+    Uint32 head = recorder->head, number = recorder->number++;
+    size_t row = recorder->w * 4;
+    RecorderSlot *slot;
+    int j;
+
+    if (recorder->writer == NULL)
+        return;
+    if (number == 0)
+        recorder->start = timing_now_ns();
+    if (head - __atomic_load_n(&recorder->tail, __ATOMIC_ACQUIRE) == RECORDER_FRAMES){
+        recorder->dropped++;
+        return;
+    }
+    slot = &recorder->slots[head & (RECORDER_FRAMES - 1)];
+    if (SDL_MUSTLOCK(surface) && SDL_LockSurface(surface) < 0){
+        recorder->dropped++;
+        return;
+    }
+    if (surface->pitch == row)
+        memcpy(slot->pixels, surface->pixels, row * recorder->h);
+    else {
+        for (j = 0; j < recorder->h; j++)
+            memcpy((Uint8 *)slot->pixels + j * row, (Uint8 *)surface->pixels + j * surface->pitch, row);
+    }
+    if (SDL_MUSTLOCK(surface))
+        SDL_UnlockSurface(surface);
+    slot->number = number;
+    slot->time = timing_now_ns() - recorder->start;
+    __atomic_store_n(&recorder->head, head + 1, __ATOMIC_RELEASE);
+    SDL_SemPost(recorder->posted);
+}
+
+void recorder_close(Recorder *recorder){
+    int i;
+
+    if (recorder->writer){
+        __atomic_store_n(&recorder->stopping, 1, __ATOMIC_RELEASE);
+        SDL_SemPost(recorder->posted);
+        SDL_WaitThread(recorder->writer, NULL);
+        printf("capture: %u frames, %u dropped%s\n", recorder->number, recorder->dropped,
+               recorder->write_error ? ", write error" : "");
+    }
+    if (recorder->file)
+        fclose(recorder->file);
+    if (recorder->posted)
+        SDL_DestroySemaphore(recorder->posted);
+    for (i = 0; i < RECORDER_FRAMES; i++)
+        free(recorder->slots[i].pixels);
+    free(recorder->previous);
+    free(recorder->scratch);
+    free(recorder->planes);
+    memset(recorder, 0, sizeof(*recorder));
+}
@@ -0,0 +1,79 @@
+#ifndef DROPS_RECORDER_H
+#define DROPS_RECORDER_H
+
+#include <stdio.h>
+
+#include <SDL.h>
+
+// Frames copied and not written yet. The game drops new ones when they are
+// all taken rather than waiting for the writer. A power of two.
+#ifdef _PSP_FW_VERSION
+#define RECORDER_FRAMES 4
+#else
+#define RECORDER_FRAMES 16
+#endif
+
+// Capture file: a header, then for each frame a RecorderFrame followed by
+// its pixels XORed with the previous frame's, encoded by delta_encode(). The
+// first frame is XORed with black.
+#define RECORDER_MAGIC 0x43455244
+#define RECORDER_VERSION 1
+
+typedef struct RecorderHeader {
+    Uint32 magic;
+    Uint32 version;
+    Uint32 w, h;
+    // Layout of the 32 bit pixels
+    Uint32 rmask, gmask, bmask;
+    // Frames per second the game meant to show, 0 when unlocked
+    Uint32 fps;
+} RecorderHeader;
+
+typedef struct RecorderFrame {
+    // Counts the frames dropped too, a gap means some are missing
+    Uint32 number;
+    Uint32 size;
+    // Since the first frame
+    Uint64 time;
+} RecorderFrame;
+
+typedef struct RecorderSlot {
+    Uint32 *pixels;
+    Uint32 number;
+    Uint64 time;
+} RecorderSlot;
+
+typedef struct Recorder {
+    FILE *file;
+    // Raw 4:2:0 frames for ffmpeg and the like instead of the capture file
+    int y4m;
+    int w, h;
+    Uint8 rshift, gshift, bshift;
+    // Single producer, the thread presenting frames, and single consumer,
+    // the writer
+    RecorderSlot slots[RECORDER_FRAMES];
+    Uint32 head, tail;
+    SDL_sem *posted;
+    SDL_Thread *writer;
+    int stopping;
+    // Writer only: the last frame written, and room to encode the next one
+    Uint32 *previous;
+    Uint8 *scratch;
+    Uint8 *planes;
+    // Number the next frame should have, 0 before the first one
+    Uint32 next_number;
+    int write_error;
+    // Game side
+    Uint32 number, dropped;
+    Uint64 start;
+} Recorder;
+
+// Record 'w' x 'h' frames of 32 bit 'format' to 'path', as Y4M when it ends
+// in .y4m
+int recorder_open(Recorder *recorder, const char *path, int w, int h, const SDL_PixelFormat *format, int fps);
+// Copy a frame for the writer, never waits
+void recorder_capture(Recorder *recorder, SDL_Surface *surface);
+// Write what is left and close the file
+void recorder_close(Recorder *recorder);
+
+#endif
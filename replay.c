@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "replay.h"
+
+#define BUTTON_NUM ((int)(sizeof(((JoystickState *)0)->buttons) / sizeof(int)))
+// Longest encoded run: two 5 byte varints, the buttons and the axes
+#define RUN_MAX 14
+
+static int same_tick(const ReplayTick *a, const ReplayTick *b){
+    return !memcmp(&a->input, &b->input, sizeof(a->input)) && a->steps == b->steps && a->paused == b->paused;
+}
+
+static Uint8 *put_varint(Uint8 *out, Uint32 v){
+    while (v >= 0x80){
+        *out++ = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    *out++ = v;
+    return out;
+}
+
+static int get_varint(Replay *replay, Uint32 *v){
+    int shift = 0;
+    Uint8 byte;
+    *v = 0;
+    do {
+        if (replay->position >= replay->size || shift > 28)
+            return -1;
+        byte = replay->data[replay->position++];
+        *v |= (Uint32)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return 0;
+}
+
+static int flush_run(Replay *replay){
+    const ReplayTick *tick = &replay->run;
+    Uint8 *out, *grown;
+    int buttons = 0, b;
+
+    if (replay->run_count == 0)
+        return 0;
+    if (replay->size + RUN_MAX > replay->capacity){
+        grown = realloc(replay->data, replay->capacity * 2 + 4096);
+        if (grown == NULL)
+            return -1;
+        replay->data = grown;
+        replay->capacity = replay->capacity * 2 + 4096;
+    }
+    for (b = 0; b < BUTTON_NUM; b++){
+        if (tick->input.buttons[b])
+            buttons |= 1 << b;
+    }
+    out = put_varint(replay->data + replay->size, replay->run_count);
+    *out++ = buttons & 0xff;
+    *out++ = buttons >> 8;
+    *out++ = keep_inside(tick->input.analog_x, 0, 255);
+    *out++ = keep_inside(tick->input.analog_y, 0, 255);
+    out = put_varint(out, (tick->steps << 1) | (tick->paused != 0));
+    replay->size = out - replay->data;
+    replay->run_count = 0;
+    return 0;
+}
+
+void replay_begin(Replay *replay, const Game *g){
+    replay->size = 0;
+    replay->run_count = 0;
+    replay->position = 0;
+    memset(&replay->header, 0, sizeof(replay->header));
+    replay->header.magic = REPLAY_MAGIC;
+    replay->header.version = REPLAY_VERSION;
+    replay->header.mode = g->mode;
+    replay->header.drop_capacity = g->drop_capacity;
+    replay->header.enemy_capacity = g->enemy_capacity;
+    replay->header.clock_phase = g->sim_fraction;
+    replay->header.rng_state = g->rng.state;
+    replay->header.rng_inc = g->rng.inc;
+}
+
+int replay_record(Replay *replay, const ReplayTick *tick){
+    replay->header.ticks++;
+    if (replay->run_count && same_tick(&replay->run, tick)){
+        replay->run_count++;
+        return 0;
+    }
+    if (flush_run(replay) < 0)
+        return -1;
+    replay->run = *tick;
+    replay->run_count = 1;
+    return 0;
+}
+
+int replay_save(Replay *replay, const Game *g, const char *path){
+    FILE *file;
+    int ok;
+
+    if (flush_run(replay) < 0)
+        return -1;
+    replay->header.points = g->player.points;
+    replay->header.level = g->level;
+    replay->header.size = replay->size;
+    file = fopen(path, "wb");
+    if (file == NULL){
+        perror(path);
+        return -1;
+    }
+    ok = fwrite(&replay->header, sizeof(replay->header), 1, file) == 1
+        && fwrite(replay->data, 1, replay->size, file) == replay->size;
+    if (fclose(file) != 0 || !ok){
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+int replay_load(Replay *replay, const char *path){
+    FILE *file = fopen(path, "rb");
+
+    memset(replay, 0, sizeof(*replay));
+    if (file == NULL){
+        perror(path);
+        return -1;
+    }
+    if (fread(&replay->header, sizeof(replay->header), 1, file) != 1
+        || replay->header.magic != REPLAY_MAGIC || replay->header.version != REPLAY_VERSION)
+        goto invalid;
+    replay->data = malloc(replay->header.size + 1);
+    if (replay->data == NULL || fread(replay->data, 1, replay->header.size, file) != replay->header.size)
+        goto invalid;
+    replay->size = replay->capacity = replay->header.size;
+    fclose(file);
+    return 0;
+
+invalid:
+    fprintf(stderr, "%s: invalid replay\n", path);
+    fclose(file);
+    replay_free(replay);
+    return -1;
+}
+
+int replay_start(Replay *replay, Game *g){
+    configure_game(g, replay->header.mode, replay->header.drop_capacity, replay->header.enemy_capacity);
+    if (reset_game(g) < 0)
+        return -1;
+    g->rng.state = replay->header.rng_state;
+    g->rng.inc = replay->header.rng_inc;
+    g->state = GAME_STATE_PLAYING;
+    g->sim_fraction = replay->header.clock_phase;
+    start_clock(g);
+    replay->position = 0;
+    replay->run_count = 0;
+    return 0;
+}
+
+int replay_next(Replay *replay, ReplayTick *tick){
+    Uint32 count, steps;
+    int buttons, b;
+
+    if (replay->run_count == 0){
+        if (get_varint(replay, &count) < 0 || count == 0 || replay->position + 4 > replay->size)
+            return 0;
+        buttons = replay->data[replay->position] | (replay->data[replay->position + 1] << 8);
+        for (b = 0; b < BUTTON_NUM; b++)
+            replay->run.input.buttons[b] = (buttons >> b) & 1;
+        replay->run.input.analog_x = replay->data[replay->position + 2];
+        replay->run.input.analog_y = replay->data[replay->position + 3];
+        replay->position += 4;
+        if (get_varint(replay, &steps) < 0)
+            return 0;
+        replay->run.steps = steps >> 1;
+        replay->run.paused = steps & 1;
+        replay->run_count = count;
+    }
+    replay->run_count--;
+    *tick = replay->run;
+    return 1;
+}
+
+void replay_advance(const ReplayTick *tick, Game *g){
+    int i;
+    if (tick->paused){
+        stop_clock(g);
+        for (i = 1; i < tick->steps; i++)
+            step_clock(g);
+        start_clock(g);
+        step_clock(g);
+        return;
+    }
+    for (i = 0; i < tick->steps; i++)
+        step_clock(g);
+}
+
+int replay_matches(const Replay *replay, const Game *g){
+    return g->player.points == (int)replay->header.points && g->level == (int)replay->header.level;
+}
+
+void replay_free(Replay *replay){
+    free(replay->data);
+    replay->data = NULL;
+    replay->size = replay->capacity = 0;
+}
@@ -0,0 +1,62 @@
+#ifndef DROPS_REPLAY_H
+#define DROPS_REPLAY_H
+
+#include "game.h"
+
+// Replay file: a header, then the input of every update_game() call of one
+// game, run-length encoded. Each run is a varint count, the buttons as a 16
+// bit mask, both analog axes as bytes and a varint of (steps << 1 | paused).
+#define REPLAY_MAGIC 0x4c505244
+#define REPLAY_VERSION 1
+
+typedef struct ReplayHeader {
+    Uint32 magic;
+    Uint32 version;
+    Uint32 mode;
+    Uint32 drop_capacity, enemy_capacity;
+    // Simulation clock fraction when the game started, see step_clock()
+    Uint32 clock_phase;
+    uint64_t rng_state, rng_inc;
+    // How the game ended, to check a replay against
+    Uint32 ticks;
+    Uint32 points;
+    Uint32 level;
+    Uint32 size;
+} ReplayHeader;
+
+// What happened before an update: 'steps' clock steps since the last one,
+// with the game paused in between when 'paused' is set
+typedef struct ReplayTick {
+    JoystickState input;
+    int steps;
+    int paused;
+} ReplayTick;
+
+typedef struct Replay {
+    ReplayHeader header;
+    Uint8 *data;
+    Uint32 size, capacity;
+    // Recording: the run not written yet. Playing: the run being played.
+    ReplayTick run;
+    Uint32 run_count;
+    Uint32 position;
+} Replay;
+
+// Start recording the game about to be played, after reset_game()
+void replay_begin(Replay *replay, const Game *g);
+int replay_record(Replay *replay, const ReplayTick *tick);
+// Write the recording with the current score as its ending
+int replay_save(Replay *replay, const Game *g, const char *path);
+
+int replay_load(Replay *replay, const char *path);
+// Set the game up as it was when the recording began, clock running
+int replay_start(Replay *replay, Game *g);
+// 0 once every tick was played
+int replay_next(Replay *replay, ReplayTick *tick);
+// Move the clocks as they moved before the update of 'tick'
+void replay_advance(const ReplayTick *tick, Game *g);
+// Does the game end as recorded ?
+int replay_matches(const Replay *replay, const Game *g);
+void replay_free(Replay *replay);
+
+#endif
@@ -0,0 +1,180 @@
+#include <string.h>
+
+#include "delta.h"
+#include "rewind.h"
+
+#define GAME_WORDS ((sizeof(Game) + 3) / 4)
+
+int rewind_init(Rewind *rewind, int ticks, Uint32 budget){
+    memset(rewind, 0, sizeof(*rewind));
+    rewind->buffer = malloc(budget);
+    rewind->records = malloc(ticks * sizeof(RewindRecord));
+    if (rewind->buffer == NULL || rewind->records == NULL){
+        rewind_free(rewind);
+        return -1;
+    }
+    rewind->budget = budget;
+    rewind->capacity = ticks;
+    return 0;
+}
+
+void rewind_free(Rewind *rewind){
+    free(rewind->buffer);
+    free(rewind->records);
+    free(rewind->image);
+    free(rewind->next);
+    free(rewind->scratch);
+    memset(rewind, 0, sizeof(*rewind));
+}
+
+void rewind_clear(Rewind *rewind){
+    rewind->first = rewind->count = 0;
+    rewind->end = 0;
+}
+
+int rewind_available(const Rewind *rewind){
+    return rewind->count > 1 ? rewind->count - 1 : 0;
+}
+
+static RewindRecord *record_at(Rewind *rewind, int n){
+    return &rewind->records[(rewind->first + n) % rewind->capacity];
+}
+
+static void drop_oldest(Rewind *rewind){
+    rewind->first = (rewind->first + 1) % rewind->capacity;
+    rewind->count--;
+}
+
+// Records depending on a dropped keyframe go with it
+static void drop_group(Rewind *rewind){
+    do {
+        drop_oldest(rewind);
+    } while (rewind->count && !record_at(rewind, 0)->keyframe);
+}
+
+// Game image sizes change with the capacities, the history goes with them
+static int size_images(Rewind *rewind, const Game *g){
+    size_t words = GAME_WORDS + g->arena_size / 4;
+
+    if (words == rewind->words)
+        return 0;
+    free(rewind->image);
+    free(rewind->next);
+    free(rewind->scratch);
+    rewind->words = words;
+    rewind->image = calloc(words, 4);
+    rewind->next = calloc(words, 4);
+    rewind->scratch = malloc(DELTA_BOUND(words));
+    rewind_clear(rewind);
+    if (rewind->image == NULL || rewind->next == NULL || rewind->scratch == NULL){
+        rewind->words = 0;
+        return -1;
+    }
+    return 0;
+}
+
+// Room for 'size' bytes at the end, wrapping around and dropping the oldest
+// records in the way
+static int make_room(Rewind *rewind, Uint32 size){
+    Uint32 offset = rewind->end;
+
+    if (size > rewind->budget)
+        return -1;
+    if (rewind->count == rewind->capacity)
+        drop_group(rewind);
+    if (offset + size > rewind->budget){
+        // The records past the end are the oldest ones
+        while (rewind->count && record_at(rewind, 0)->offset >= offset)
+            drop_group(rewind);
+        offset = 0;
+    }
+    while (rewind->count && record_at(rewind, 0)->offset >= offset && record_at(rewind, 0)->offset < offset + size)
+        drop_group(rewind);
+    if (rewind->count == 0)
+        offset = 0;
+    rewind->end = offset;
+    return 0;
+}
+
+int rewind_push(Rewind *rewind, const Game *g){
+    RewindRecord *record;
+    Uint32 size, *swap;
+    size_t i;
+    int keyframe;
+
+    if (size_images(rewind, g) < 0)
+        return -1;
+    memcpy(rewind->next, g, sizeof(Game));
+    memcpy(rewind->next + GAME_WORDS, g->arena, g->arena_size);
+    // No pointers in the history, they only mean something for this arena
+    ((Game *)rewind->next)->arena = NULL;
+    relayout_game((Game *)rewind->next);
+
+    // The previous image is not needed past this point, the delta goes over it
+    keyframe = rewind->count == 0 || rewind->snapshots % REWIND_KEYFRAME_INTERVAL == 0;
+    if (keyframe)
+        memcpy(rewind->image, rewind->next, rewind->words * 4);
+    else {
+        for (i = 0; i < rewind->words; i++)
+            rewind->image[i] ^= rewind->next[i];
+    }
+    size = delta_encode(rewind->scratch, rewind->image, rewind->words);
+    if (make_room(rewind, size) < 0){
+        rewind_clear(rewind);
+        return -1;
+    }
+    // Dropped the keyframe this delta was relative to
+    if (!keyframe && rewind->count == 0){
+        keyframe = 1;
+        size = delta_encode(rewind->scratch, rewind->next, rewind->words);
+        if (make_room(rewind, size) < 0)
+            return -1;
+    }
+
+    record = record_at(rewind, rewind->count++);
+    record->offset = rewind->end;
+    record->size = size;
+    record->keyframe = keyframe;
+    memcpy(rewind->buffer + record->offset, rewind->scratch, size);
+    rewind->end += size;
+    swap = rewind->image;
+    rewind->image = rewind->next;
+    rewind->next = swap;
+    rewind->snapshots++;
+    rewind->stored += size;
+    return 0;
+}
+
+int rewind_back(Rewind *rewind, Game *g){
+    RewindRecord *newest, *record;
+    void *arena = g->arena;
+    size_t arena_size = g->arena_size;
+    int n, k;
+
+    if (rewind->count < 2 || rewind->words != GAME_WORDS + g->arena_size / 4)
+        return 0;
+    newest = record_at(rewind, rewind->count - 1);
+    if (!newest->keyframe){
+        // XOR both ways: the delta takes the newest image back one update
+        delta_apply(rewind->image, rewind->buffer + newest->offset, newest->size);
+    }
+    else {
+        // Rebuild from the previous keyframe
+        for (k = rewind->count - 2; !record_at(rewind, k)->keyframe; k--)
+            ;
+        memset(rewind->image, 0, rewind->words * 4);
+        for (n = k; n < rewind->count - 1; n++){
+            record = record_at(rewind, n);
+            delta_apply(rewind->image, rewind->buffer + record->offset, record->size);
+        }
+    }
+    rewind->end = newest->offset;
+    rewind->count--;
+
+    memcpy(g, rewind->image, sizeof(Game));
+    g->arena = arena;
+    g->arena_size = arena_size;
+    relayout_game(g);
+    memcpy(g->arena, rewind->image + GAME_WORDS, g->arena_size);
+    return 1;
+}
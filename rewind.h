@@ -0,0 +1,54 @@
+#ifndef DROPS_REWIND_H
+#define DROPS_REWIND_H
+
+#include "game.h"
+
+// History memory, the PSP has to fit it in its heap with everything else
+#ifdef _PSP_FW_VERSION
+#define REWIND_BUDGET (2 << 20)
+#else
+#define REWIND_BUDGET (16 << 20)
+#endif
+
+// A keyframe every second, stepping back never replays more deltas than that
+#define REWIND_KEYFRAME_INTERVAL TICK_RATE
+
+// One snapshot per update. The image of a game is the Game struct, its
+// pointers cleared, followed by its arena, as 32 bit words. Keyframes hold the image itself, the other
+// records the XOR with the previous image, both run-length encoded by
+// delta_encode().
+typedef struct RewindRecord {
+    Uint32 offset, size;
+    int keyframe;
+} RewindRecord;
+
+typedef struct Rewind {
+    // Records are laid out one after the other, wrapping back to the start
+    // when the next one does not fit. The oldest one is always a keyframe.
+    Uint8 *buffer;
+    Uint32 budget, end;
+    RewindRecord *records;
+    int capacity, first, count;
+    // Image of the newest record, the next one being built, and room to
+    // encode it
+    Uint32 *image, *next;
+    Uint8 *scratch;
+    size_t words;
+    // Since the creation, for benchmarks
+    uint64_t snapshots, stored;
+} Rewind;
+
+// Keep up to 'ticks' updates within 'budget' bytes
+int rewind_init(Rewind *rewind, int ticks, Uint32 budget);
+void rewind_free(Rewind *rewind);
+// Forget everything, when a new game starts
+void rewind_clear(Rewind *rewind);
+// Snapshot the game after an update
+int rewind_push(Rewind *rewind, const Game *g);
+// Put the game back as it was one update earlier and forget the newest
+// snapshot, 0 when there is nothing older
+int rewind_back(Rewind *rewind, Game *g);
+// Updates that can be undone
+int rewind_available(const Rewind *rewind);
+
+#endif
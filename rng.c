@@ -0,0 +1,19 @@
+#include "rng.h"
+
+void rng_seed(Rng *rng, uint64_t seed, uint64_t stream){
+    rng->state = 0;
+    rng->inc = (stream << 1) | 1;
+    rng_next(rng);
+    rng->state += seed;
+    rng_next(rng);
+}
+
+void rng_fill_bits(Rng *rng, int *out, int count){
+    uint32_t bits;
+    int i, k;
+    for (i = 0; i < count; i += 32){
+        bits = rng_next(rng);
+        for (k = 0; k < 32 && i + k < count; k++)
+            out[i + k] = (bits >> k) & 1;
+    }
+}
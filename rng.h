@@ -0,0 +1,28 @@
+#ifndef DROPS_RNG_H
+#define DROPS_RNG_H
+
+#include <stdint.h>
+
+// PCG32: 64 bit state, one of 2^63 streams picked by 'inc'
+typedef struct Rng {
+    uint64_t state, inc;
+} Rng;
+
+// Different streams from the same seed are distinct sequences
+void rng_seed(Rng *rng, uint64_t seed, uint64_t stream);
+// out[i] = 0 or 1, 32 of them per draw
+void rng_fill_bits(Rng *rng, int *out, int count);
+
+static inline uint32_t rng_next(Rng *rng){
+    uint64_t state = rng->state;
+    uint32_t xorshifted = ((state >> 18) ^ state) >> 27, rot = state >> 59;
+    rng->state = state * 6364136223846793005ull + rng->inc;
+    return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+}
+
+// In [0, n), n > 0
+static inline int rng_below(Rng *rng, int n){
+    return (int)(((uint64_t)rng_next(rng) * (uint32_t)n) >> 32);
+}
+
+#endif
@@ -0,0 +1,49 @@
+#include <string.h>
+
+#include "jobs.h"
+#include "runner.h"
+
+typedef struct RunJob {
+    GameRun *runs;
+    int failed;
+} RunJob;
+
+static int play_run(GameRun *run){
+    Game g;
+    JoystickState input;
+
+    // Serial, the workers are all busy with other games
+    memset(&g, 0, sizeof(g));
+    configure_game(&g, run->mode, run->drop_capacity, run->enemy_capacity);
+    seed_game(&g, run->seed);
+    if (reset_game(&g) < 0)
+        return -1;
+    g.state = GAME_STATE_PLAYING;
+    start_clock(&g);
+    for (run->ticks = 0; g.state == GAME_STATE_PLAYING && (run->max_ticks <= 0 || run->ticks < run->max_ticks); run->ticks++){
+        step_clock(&g);
+        run->policy(&g, &input, run->policy_data);
+        update_game(&g, &input);
+    }
+    run->level = g.level;
+    run->points = g.player.points;
+    run->life = g.player.life;
+    run->over = g.state == GAME_STATE_OVER;
+    free_game(&g);
+    return 0;
+}
+
+static void play_chunk(void *data, int begin, int end){
+    RunJob *job = data;
+    int i;
+    for (i = begin; i < end; i++){
+        if (play_run(&job->runs[i]) < 0)
+            __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+    }
+}
+
+int run_games(GameRun *runs, int count){
+    RunJob job = { runs, 0 };
+    jobs_run(play_chunk, &job, count, 1);
+    return job.failed ? -1 : 0;
+}
@@ -0,0 +1,31 @@
+#ifndef DROPS_RUNNER_H
+#define DROPS_RUNNER_H
+
+#include "game.h"
+
+// Picks the input of the next update, from what the game looks like now
+typedef void (*InputPolicy)(const Game *g, JoystickState *input, void *data);
+
+typedef struct GameRun {
+    uint64_t seed;
+    enum GameMode mode;
+    // 0 for the mode defaults, as with configure_game()
+    int drop_capacity, enemy_capacity;
+    InputPolicy policy;
+    void *policy_data;
+    // The run stops there when the game is still going, 0 for no limit
+    long max_ticks;
+    // How it went
+    long ticks;
+    int level;
+    int points;
+    int life;
+    int over;
+} GameRun;
+
+// Play every run from a fresh game, spread over the job pool, one game per
+// thread at a time. Policies get called from several threads at once.
+// Returns -1 when a game could not be allocated.
+int run_games(GameRun *runs, int count);
+
+#endif
@@ -0,0 +1,165 @@
+#include <string.h>
+
+#include "scale.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SCALE_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SCALE_NEON
+#endif
+
+static void repeat_pixels(Uint32 *dst, const Uint32 *src, int w, int factor){
+    int i, k;
+    for (i = 0; i < w; i++){
+        for (k = 0; k < factor; k++)
+            *dst++ = src[i];
+    }
+}
+
+#if defined(SCALE_SSE2)
+// Four pixels in, four times 'factor' out, shuffled within the register
+void scale_row(Uint32 *dst, const Uint32 *src, int w, int factor){
+    __m128i p;
+    int i = 0;
+
+    switch (factor){
+    case 2:
+        for (; i + 4 <= w; i += 4, dst += 8){
+            p = _mm_loadu_si128((const __m128i *)(src + i));
+            _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi32(p, p));
+            _mm_storeu_si128((__m128i *)(dst + 4), _mm_unpackhi_epi32(p, p));
+        }
+        break;
+    case 3:
+        for (; i + 4 <= w; i += 4, dst += 12){
+            p = _mm_loadu_si128((const __m128i *)(src + i));
+            _mm_storeu_si128((__m128i *)dst, _mm_shuffle_epi32(p, _MM_SHUFFLE(1, 0, 0, 0)));
+            _mm_storeu_si128((__m128i *)(dst + 4), _mm_shuffle_epi32(p, _MM_SHUFFLE(2, 2, 1, 1)));
+            _mm_storeu_si128((__m128i *)(dst + 8), _mm_shuffle_epi32(p, _MM_SHUFFLE(3, 3, 3, 2)));
+        }
+        break;
+    case 4:
+        for (; i + 4 <= w; i += 4, dst += 16){
+            p = _mm_loadu_si128((const __m128i *)(src + i));
+            _mm_storeu_si128((__m128i *)dst, _mm_shuffle_epi32(p, _MM_SHUFFLE(0, 0, 0, 0)));
+            _mm_storeu_si128((__m128i *)(dst + 4), _mm_shuffle_epi32(p, _MM_SHUFFLE(1, 1, 1, 1)));
+            _mm_storeu_si128((__m128i *)(dst + 8), _mm_shuffle_epi32(p, _MM_SHUFFLE(2, 2, 2, 2)));
+            _mm_storeu_si128((__m128i *)(dst + 12), _mm_shuffle_epi32(p, _MM_SHUFFLE(3, 3, 3, 3)));
+        }
+        break;
+    }
+    repeat_pixels(dst, src + i, w - i, factor);
+}
+#elif defined(SCALE_NEON)
+// Interleaving stores of the same register 'factor' times
+void scale_row(Uint32 *dst, const Uint32 *src, int w, int factor){
+    uint32x4x2_t p2;
+    uint32x4x3_t p3;
+    uint32x4x4_t p4;
+    int i = 0;
+
+    switch (factor){
+    case 2:
+        for (; i + 4 <= w; i += 4, dst += 8){
+            p2.val[0] = p2.val[1] = vld1q_u32(src + i);
+            vst2q_u32(dst, p2);
+        }
+        break;
+    case 3:
+        for (; i + 4 <= w; i += 4, dst += 12){
+            p3.val[0] = p3.val[1] = p3.val[2] = vld1q_u32(src + i);
+            vst3q_u32(dst, p3);
+        }
+        break;
+    case 4:
+        for (; i + 4 <= w; i += 4, dst += 16){
+            p4.val[0] = p4.val[1] = p4.val[2] = p4.val[3] = vld1q_u32(src + i);
+            vst4q_u32(dst, p4);
+        }
+        break;
+    }
+    repeat_pixels(dst, src + i, w - i, factor);
+}
+#else
+void scale_row(Uint32 *dst, const Uint32 *src, int w, int factor){
+    repeat_pixels(dst, src, w, factor);
+}
+#endif
+
+int scale_fit(int width, int height, int w, int h){
+    int factor = SCALE_MAX;
+    while (factor > 1 && (width * factor > w || height * factor > h))
+        factor--;
+    return factor;
+}
+
+void scale_init(Scaler *scaler, SDL_Surface *source, SDL_Surface *target, int factor){
+    scaler->source = source;
+    scaler->target = target;
+    scaler->factor = factor;
+    scaler->x = (target->w - source->w * factor) / 2;
+    scaler->y = (target->h - source->h * factor) / 2;
+    scaler->unclear = scaler->x || scaler->y ? (target->flags & SDL_DOUBLEBUF ? 2 : 1) : 0;
+}
+
+// Each source row is widened once, the other lines of the block are copies
+static void scale_area(Scaler *scaler, const SDL_Rect *area){
+    SDL_Surface *source = scaler->source, *target = scaler->target;
+    int factor = scaler->factor, j, k, bytes = area->w * factor * 4;
+    const Uint8 *src = (const Uint8 *)source->pixels + area->y * source->pitch + area->x * 4;
+    Uint8 *dst = (Uint8 *)target->pixels + (scaler->y + area->y * factor) * target->pitch + (scaler->x + area->x * factor) * 4;
+
+    for (j = 0; j < area->h; j++, src += source->pitch, dst += factor * target->pitch){
+        scale_row((Uint32 *)dst, (const Uint32 *)src, area->w, factor);
+        for (k = 1; k < factor; k++)
+            memcpy(dst + k * target->pitch, dst, bytes);
+    }
+}
+
+static void clear_bars(Scaler *scaler){
+    SDL_Surface *target = scaler->target;
+    int w = scaler->source->w * scaler->factor, h = scaler->source->h * scaler->factor;
+    SDL_Rect bars[4] = {
+        { 0, 0, target->w, scaler->y },
+        { 0, scaler->y + h, target->w, target->h - scaler->y - h },
+        { 0, scaler->y, scaler->x, h },
+        { scaler->x + w, scaler->y, target->w - scaler->x - w, h },
+    };
+    int i;
+
+    for (i = 0; i < 4; i++)
+        SDL_FillRect(target, &bars[i], 0);
+    scaler->unclear--;
+}
+
+void scale_all(Scaler *scaler){
+    SDL_Rect all = { 0, 0, scaler->source->w, scaler->source->h };
+
+    if (scaler->unclear)
+        clear_bars(scaler);
+    if (SDL_MUSTLOCK(scaler->target) && SDL_LockSurface(scaler->target) < 0)
+        return;
+    scale_area(scaler, &all);
+    if (SDL_MUSTLOCK(scaler->target))
+        SDL_UnlockSurface(scaler->target);
+}
+
+void scale_rects(Scaler *scaler, SDL_Rect *rects, int count){
+    int i;
+
+    if (scaler->unclear)
+        clear_bars(scaler);
+    if (SDL_MUSTLOCK(scaler->target) && SDL_LockSurface(scaler->target) < 0)
+        return;
+    for (i = 0; i < count; i++){
+        scale_area(scaler, &rects[i]);
+        rects[i].x = scaler->x + rects[i].x * scaler->factor;
+        rects[i].y = scaler->y + rects[i].y * scaler->factor;
+        rects[i].w *= scaler->factor;
+        rects[i].h *= scaler->factor;
+    }
+    if (SDL_MUSTLOCK(scaler->target))
+        SDL_UnlockSurface(scaler->target);
+}
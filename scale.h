@@ -0,0 +1,31 @@
+#ifndef DROPS_SCALE_H
+#define DROPS_SCALE_H
+
+#include <SDL.h>
+
+#define SCALE_MAX 4
+
+// The game draws at its own size into 'source', which gets blown up by a
+// whole factor, nearest neighbour, into the middle of 'target'. The bars
+// around it stay black.
+typedef struct Scaler {
+    SDL_Surface *source, *target;
+    int factor;
+    // Top left corner of the picture on the target
+    int x, y;
+    // Target buffers whose bars still have to be cleared, two when flipping
+    int unclear;
+} Scaler;
+
+// Largest factor, up to SCALE_MAX, at which 'width' x 'height' fits 'w' x 'h'
+int scale_fit(int width, int height, int w, int h);
+// Both surfaces 32 bit with the same format, the target big enough
+void scale_init(Scaler *scaler, SDL_Surface *source, SDL_Surface *target, int factor);
+// Scale the whole picture
+void scale_all(Scaler *scaler);
+// Scale the given source areas, the rects become the target areas to update
+void scale_rects(Scaler *scaler, SDL_Rect *rects, int count);
+// 'w' pixels repeated 'factor' times each
+void scale_row(Uint32 *dst, const Uint32 *src, int w, int factor);
+
+#endif
@@ -0,0 +1,76 @@
+#include <math.h>
+
+#include "sprite.h"
+
+// Open addressing table, a power of two
+#define SPRITE_CACHE_SIZE 512
+
+typedef struct CircleSprite {
+    int r;
+    Uint32 rgba;
+    SDL_Surface *surface;
+} CircleSprite;
+
+static CircleSprite cache[SPRITE_CACHE_SIZE];
+
+// Same coverage rule for every circle: full inside r - 0.5, none past r + 0.5
+static SDL_Surface *rasterize(int r, Uint32 rgba){
+    SDL_Surface *argb, *converted;
+    Uint32 rgb = rgba >> 8, alpha = rgba & 0xff, *row;
+    int size = 2 * r + 3, i, j, dx, dy;
+    float coverage;
+
+    argb = SDL_CreateRGBSurface(SDL_SWSURFACE, size, size, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+    if (argb == NULL)
+        return NULL;
+    for (j = 0; j < size; j++){
+        row = (Uint32 *)((Uint8 *)argb->pixels + j * argb->pitch);
+        dy = j - r - 1;
+        for (i = 0; i < size; i++){
+            dx = i - r - 1;
+            coverage = r + 0.5f - sqrtf(dx * dx + dy * dy);
+            if (coverage <= 0)
+                row[i] = 0;
+            else if (coverage >= 1)
+                row[i] = (alpha << 24) | rgb;
+            else
+                row[i] = ((Uint32)(alpha * coverage + 0.5f) << 24) | rgb;
+        }
+    }
+
+    converted = SDL_DisplayFormatAlpha(argb);
+    if (converted == NULL)
+        return argb;
+    SDL_FreeSurface(argb);
+    return converted;
+}
+
+SDL_Surface *circle_sprite(int r, Uint32 rgba){
+    unsigned int i, n;
+    CircleSprite *sprite;
+
+    if (r < 1 || r > SPRITE_MAX_RADIUS)
+        return NULL;
+
+    i = (rgba * 2654435761u) ^ (r * 40503u);
+    for (n = 0; n < SPRITE_CACHE_SIZE; n++){
+        sprite = &cache[(i + n) & (SPRITE_CACHE_SIZE - 1)];
+        if (sprite->r == r && sprite->rgba == rgba)
+            return sprite->surface;
+        if (sprite->r == 0){
+            sprite->surface = rasterize(r, rgba);
+            if (sprite->surface == NULL)
+                return NULL;
+            sprite->r = r;
+            sprite->rgba = rgba;
+            return sprite->surface;
+        }
+    }
+    return NULL;
+}
+
+void warm_circle_sprites(Uint32 rgba, int min_r, int max_r){
+    int r;
+    for (r = min_r; r <= max_r; r++)
+        circle_sprite(r, rgba);
+}
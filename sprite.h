@@ -0,0 +1,14 @@
+#ifndef DROPS_SPRITE_H
+#define DROPS_SPRITE_H
+
+#include <SDL.h>
+
+// Bigger circles are not worth keeping around, they are drawn span by span
+#define SPRITE_MAX_RADIUS 48
+
+// Anti-aliased circle of radius r centered in a (2r + 3)^2 surface, built the
+// first time it is asked for. NULL if it can't be cached.
+SDL_Surface *circle_sprite(int r, Uint32 rgba);
+void warm_circle_sprites(Uint32 rgba, int min_r, int max_r);
+
+#endif
@@ -0,0 +1,206 @@
+#include <string.h>
+
+#include "text.h"
+
+#define ATLAS_WIDTH 512
+#define TEXT_CACHE_SIZE 16
+// Longer strings are cut, so they would be composed again on every draw
+#define TEXT_MAX 128
+
+#define AMASK 0xff000000
+#define RMASK 0x00ff0000
+#define GMASK 0x0000ff00
+#define BMASK 0x000000ff
+
+typedef struct CachedText {
+    const GlyphAtlas *atlas;
+    Uint32 rgba;
+    char text[TEXT_MAX];
+    SDL_Surface *surface;
+    // The first glyph may stick out on the left of the pen position
+    int left;
+    Uint32 last_used;
+} CachedText;
+
+static CachedText cache[TEXT_CACHE_SIZE];
+static Uint32 cache_clock;
+
+int glyph_index(char c){
+    unsigned char u = c;
+    if (u < GLYPH_FIRST || u > GLYPH_LAST)
+        return '?' - GLYPH_FIRST;
+    return u - GLYPH_FIRST;
+}
+
+// Copy a glyph coverage as alpha over a plain color, keeping the strongest
+// coverage where two glyphs overlap. dst must be one of our ARGB surfaces.
+static void copy_coverage(SDL_Surface *src, const SDL_Rect *from, SDL_Surface *dst, int x, int y, Uint32 rgb){
+    int i, j, w = from->w, h = from->h;
+    Uint32 *s, *d, a;
+
+    if (x + w > dst->w)
+        w = dst->w - x;
+    if (y + h > dst->h)
+        h = dst->h - y;
+    for (j = 0; j < h; j++){
+        s = (Uint32 *)((Uint8 *)src->pixels + (from->y + j) * src->pitch) + from->x;
+        d = (Uint32 *)((Uint8 *)dst->pixels + (y + j) * dst->pitch) + x;
+        for (i = 0; i < w; i++){
+            a = (s[i] & src->format->Amask) >> src->format->Ashift;
+            if (a > d[i] >> 24)
+                d[i] = (a << 24) | rgb;
+        }
+    }
+}
+
+int atlas_init(GlyphAtlas *atlas, TTF_Font *font){
+    SDL_Color white = { 255, 255, 255 };
+    SDL_Surface *glyphs[GLYPH_NUM];
+    SDL_Rect from;
+    char text[2] = { 0, 0 };
+    int i, minx, maxx, miny, maxy, advance;
+    int x = 0, y = 0, row_height = 0;
+
+    memset(atlas, 0, sizeof(*atlas));
+    if (font == NULL)
+        return -1;
+    atlas->height = TTF_FontHeight(font);
+
+    // Rasterize each glyph alone and shelve them in rows
+    for (i = 0; i < GLYPH_NUM; i++){
+        text[0] = GLYPH_FIRST + i;
+        glyphs[i] = TTF_RenderText_Blended(font, text, white);
+        if (TTF_GlyphMetrics(font, GLYPH_FIRST + i, &minx, &maxx, &miny, &maxy, &advance) == 0){
+            atlas->advances[i] = advance;
+            atlas->origins[i] = minx < 0 ? -minx : 0;
+        }
+        if (glyphs[i] == NULL)
+            continue;
+        if (x + glyphs[i]->w > ATLAS_WIDTH){
+            x = 0;
+            y += row_height;
+            row_height = 0;
+        }
+        atlas->glyphs[i].x = x;
+        atlas->glyphs[i].y = y;
+        atlas->glyphs[i].w = glyphs[i]->w;
+        atlas->glyphs[i].h = glyphs[i]->h;
+        x += glyphs[i]->w;
+        if (glyphs[i]->h > row_height)
+            row_height = glyphs[i]->h;
+    }
+
+    atlas->surface = SDL_CreateRGBSurface(SDL_SWSURFACE, ATLAS_WIDTH, y + row_height, 32, RMASK, GMASK, BMASK, AMASK);
+    if (atlas->surface)
+        SDL_FillRect(atlas->surface, NULL, 0);
+    for (i = 0; i < GLYPH_NUM; i++){
+        if (glyphs[i] == NULL)
+            continue;
+        if (atlas->surface){
+            from.x = from.y = 0;
+            from.w = glyphs[i]->w;
+            from.h = glyphs[i]->h;
+            SDL_LockSurface(glyphs[i]);
+            copy_coverage(glyphs[i], &from, atlas->surface, atlas->glyphs[i].x, atlas->glyphs[i].y, 0xffffff);
+            SDL_UnlockSurface(glyphs[i]);
+        }
+        SDL_FreeSurface(glyphs[i]);
+    }
+    return atlas->surface ? 0 : -1;
+}
+
+int text_width(const GlyphAtlas *atlas, const char *text){
+    int width = 0;
+    for (; *text; text++)
+        width += atlas->advances[glyph_index(*text)];
+    return width;
+}
+
+// Blits are the fastest from the screen format. SDL2 renderers convert the
+// surfaces they make textures of themselves.
+static SDL_Surface *display_format(SDL_Surface *surface){
+#if SDL_MAJOR_VERSION < 2
+    SDL_Surface *converted = SDL_DisplayFormatAlpha(surface);
+    if (converted == NULL)
+        return surface;
+    SDL_FreeSurface(surface);
+    return converted;
+#else
+    return surface;
+#endif
+}
+
+static SDL_Surface *compose(const GlyphAtlas *atlas, const char *text, Uint32 rgba, int *left){
+    SDL_Surface *run;
+    const SDL_Rect *glyph;
+    Uint32 rgb = rgba >> 8;
+    int i, g, x, pen = 0, right = 0;
+
+    *left = 0;
+    for (i = 0; text[i]; i++){
+        g = glyph_index(text[i]);
+        x = pen - atlas->origins[g];
+        if (x < *left)
+            *left = x;
+        if (x + atlas->glyphs[g].w > right)
+            right = x + atlas->glyphs[g].w;
+        pen += atlas->advances[g];
+    }
+    if (right <= *left)
+        return NULL;
+
+    run = SDL_CreateRGBSurface(SDL_SWSURFACE, right - *left, atlas->height, 32, RMASK, GMASK, BMASK, AMASK);
+    if (run == NULL)
+        return NULL;
+    SDL_FillRect(run, NULL, 0);
+    pen = -*left;
+    for (i = 0; text[i]; i++){
+        g = glyph_index(text[i]);
+        glyph = &atlas->glyphs[g];
+        if (glyph->w)
+            copy_coverage(atlas->surface, glyph, run, pen - atlas->origins[g], 0, rgb);
+        pen += atlas->advances[g];
+    }
+
+    return display_format(run);
+}
+
+void text_draw(SDL_Surface *dst, int x, int y, GlyphAtlas *atlas, const char *text, Uint32 rgba, SDL_Rect *area){
+    CachedText *entry = NULL, *oldest = &cache[0];
+    SDL_Rect pos;
+    int i;
+
+    if (area)
+        area->w = area->h = 0;
+    if (atlas->surface == NULL)
+        return;
+
+    cache_clock++;
+    for (i = 0; i < TEXT_CACHE_SIZE; i++){
+        if (cache[i].atlas == atlas && cache[i].rgba == rgba && !strcmp(cache[i].text, text)){
+            entry = &cache[i];
+            break;
+        }
+        if (cache[i].last_used < oldest->last_used)
+            oldest = &cache[i];
+    }
+    if (entry == NULL){
+        entry = oldest;
+        if (entry->surface)
+            SDL_FreeSurface(entry->surface);
+        entry->atlas = atlas;
+        entry->rgba = rgba;
+        strncpy(entry->text, text, TEXT_MAX - 1);
+        entry->text[TEXT_MAX - 1] = 0;
+        entry->surface = compose(atlas, entry->text, rgba, &entry->left);
+    }
+    entry->last_used = cache_clock;
+
+    if (entry->surface == NULL)
+        return;
+    pos.x = x + entry->left;
+    pos.y = y;
+    SDL_BlitSurface(entry->surface, NULL, dst, &pos);
+    if (area)
+        *area = pos;
+}
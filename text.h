@@ -0,0 +1,29 @@
+#ifndef DROPS_TEXT_H
+#define DROPS_TEXT_H
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+
+#define GLYPH_FIRST 32
+#define GLYPH_LAST 126
+#define GLYPH_NUM (GLYPH_LAST - GLYPH_FIRST + 1)
+
+// Every printable glyph of a font, rasterized once into a single surface
+typedef struct GlyphAtlas {
+    SDL_Surface *surface;
+    SDL_Rect glyphs[GLYPH_NUM];
+    // Where the pen sits inside each glyph rect, and how far it moves after it
+    int origins[GLYPH_NUM];
+    int advances[GLYPH_NUM];
+    int height;
+} GlyphAtlas;
+
+int atlas_init(GlyphAtlas *atlas, TTF_Font *font);
+// Which glyph of the atlas draws c, '?' for anything unprintable
+int glyph_index(char c);
+int text_width(const GlyphAtlas *atlas, const char *text);
+// Strings are composed from the atlas the first time they are drawn, then
+// cached. 'area' (optional) gets the part of dst that was drawn over.
+void text_draw(SDL_Surface *dst, int x, int y, GlyphAtlas *atlas, const char *text, Uint32 rgba, SDL_Rect *area);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef DROPS_TIMING_H
+#define DROPS_TIMING_H
+
+#include <stdint.h>
+
+#ifdef _PSP_FW_VERSION
+#include <psprtc.h>
+#include <pspthreadman.h>
+#else
+#include <time.h>
+#endif
+
+// Monotonic high resolution clock, in nanoseconds
+static inline uint64_t timing_now_ns(){
+#ifdef _PSP_FW_VERSION
+    return (uint64_t)sceKernelGetSystemTimeWide() * 1000;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+#endif
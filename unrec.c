@@ -0,0 +1,86 @@
+// Offline capture decoder: turns a --capture file back into numbered images
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "delta.h"
+#include "recorder.h"
+
+static void usage(const char *name){
+    fprintf(stderr, "usage: %s capture [prefix]\n\nwrites prefix000000.bmp and on, one per frame shown,\n"
+            "dropped frames repeat the one before. The default prefix is 'frame'.\n", name);
+    exit(1);
+}
+
+static int save(SDL_Surface *surface, const char *prefix, Uint32 n){
+    char path[1024];
+    snprintf(path, sizeof(path), "%s%06u.bmp", prefix, n);
+    if (SDL_SaveBMP(surface, path) < 0){
+        fprintf(stderr, "%s: %s\n", path, SDL_GetError());
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]){
+    const char *prefix = "frame";
+    RecorderHeader header;
+    RecorderFrame frame;
+    SDL_Surface *surface;
+    Uint32 *image, n = 0, frames = 0, dropped = 0;
+    Uint8 *data;
+    Uint64 time = 0;
+    FILE *file;
+
+    if (argc < 2 || argc > 3 || argv[1][0] == '-')
+        usage(argv[0]);
+    if (argc == 3)
+        prefix = argv[2];
+    file = fopen(argv[1], "rb");
+    if (file == NULL){
+        perror(argv[1]);
+        return 1;
+    }
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != RECORDER_MAGIC || header.version != RECORDER_VERSION){
+        fprintf(stderr, "%s: not a capture file\n", argv[1]);
+        return 1;
+    }
+    image = calloc(header.w * header.h, 4);
+    data = malloc(DELTA_BOUND(header.w * header.h));
+    if (image == NULL || data == NULL){
+        fprintf(stderr, "%s: not enough memory\n", argv[0]);
+        return 1;
+    }
+    surface = SDL_CreateRGBSurfaceFrom(image, header.w, header.h, 32, header.w * 4, header.rmask, header.gmask, header.bmask, 0);
+    if (surface == NULL){
+        fprintf(stderr, "%s: %s\n", argv[0], SDL_GetError());
+        return 1;
+    }
+
+    while (fread(&frame, sizeof(frame), 1, file) == 1){
+        if (frame.size > DELTA_BOUND(header.w * header.h) || frame.number < n
+            || (frame.size && fread(data, frame.size, 1, file) != 1)){
+            fprintf(stderr, "%s: truncated after frame %u\n", argv[1], n);
+            break;
+        }
+        // The previous image stands in for the frames that never made it
+        for (; frames && n < frame.number; n++, dropped++){
+            if (save(surface, prefix, n) < 0)
+                return 1;
+        }
+        delta_apply(image, data, frame.size);
+        n = frame.number;
+        if (save(surface, prefix, n++) < 0)
+            return 1;
+        frames++;
+        time = frame.time;
+    }
+    fclose(file);
+    printf("%s: %u frames of %ux%u, %u dropped, %.2f s", argv[1], frames, header.w, header.h, dropped, time / 1e9);
+    if (header.fps)
+        printf(", meant for %u fps", header.fps);
+    printf("\n");
+    return 0;
+}